@@ -0,0 +1,318 @@
+#include "board.hpp"
+#include "evaluate.hpp"
+#include "move.hpp"
+#include "search.hpp"
+#include "tree-search.hpp"
+#include "undo_move.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Micro-benchmarks for the hot paths, run over a fixed position set.
+ *
+ * usage: bench [--filter substring] [--min-time seconds] [--json file]
+ *
+ * Every benchmark is repeated with a doubling operation count until it
+ * runs for at least --min-time, then ns/op and ops/s are reported.
+ * The JSON output is meant to be diffed between commits.
+ */
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 3",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 3 8",
+    "2r3k1/1q3ppp/p3p3/1p1nP3/3P4/P2Q1N2/1P3PPP/2R3K1 b - - 2 27",
+    "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+};
+
+struct BenchmarkResult {
+  std::string name;
+  uint64_t operations;
+  double seconds;
+};
+
+// results are folded into this so the compiler cannot drop the work
+uint64_t checksum = 0;
+
+// depth of the recorded perft trees replayed by perft_make_unmake
+constexpr int32_t REPLAY_DEPTH = 3;
+
+// a perft tree in preorder, every move is followed by its replies
+struct ReplayNode {
+  Move move;
+  // index one past the last reply
+  uint32_t end;
+};
+
+void recordTree(Board &board, int32_t depth, std::vector<ReplayNode> &tree) {
+  std::vector<Move> moves;
+  MoveExplorer::searchAllMoves(board, board.getPlayerTurn(), moves);
+  for (const Move &move : moves) {
+    const std::size_t index = tree.size();
+    tree.push_back(ReplayNode{move, 0});
+    if (depth > 1) {
+      UndoMove undo_move;
+      board.makeMove(move, undo_move);
+      recordTree(board, depth - 1, tree);
+      board.unmakeMove(undo_move);
+    }
+    tree[index].end = tree.size();
+  }
+}
+
+// plays the tree back without generating moves, returns the moves made
+uint64_t replayTree(Board &board, const std::vector<ReplayNode> &tree,
+                    std::size_t begin, std::size_t end) {
+  uint64_t operations = 0;
+  UndoMove undo_move;
+  for (std::size_t i = begin; i < end; i = tree[i].end) {
+    board.makeMove(tree[i].move, undo_move);
+    operations += 1 + replayTree(board, tree, i + 1, tree[i].end);
+    board.unmakeMove(undo_move);
+  }
+  return operations;
+}
+
+struct Fixture {
+  std::vector<Board> boards;
+  std::vector<std::vector<Move>> moves;
+  std::vector<std::vector<ReplayNode>> trees;
+
+  Fixture() {
+    for (const std::string_view fen : fens) {
+      boards.emplace_back(fen);
+
+      std::vector<Move> position_moves;
+      MoveExplorer::searchAllMoves(boards.back(),
+                                   boards.back().getPlayerTurn(),
+                                   position_moves);
+      moves.push_back(std::move(position_moves));
+
+      trees.emplace_back();
+      recordTree(boards.back(), REPLAY_DEPTH, trees.back());
+    }
+  }
+};
+
+/*
+ * body(rounds) runs the measured operation rounds times over the whole
+ * position set and returns how many operations that was.
+ */
+template <typename Body>
+BenchmarkResult runBenchmark(std::string_view name, double min_time,
+                             Body &&body) {
+  uint64_t rounds = 1;
+  while (true) {
+    const auto start_time = Clock::now();
+    const uint64_t operations = body(rounds);
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start_time).count();
+
+    if (seconds >= min_time || rounds >= (uint64_t{1} << 40)) {
+      return BenchmarkResult{std::string(name), operations, seconds};
+    }
+    rounds *= 2;
+  }
+}
+
+std::vector<BenchmarkResult> runAll(Fixture &fixture, std::string_view filter,
+                                    double min_time) {
+  std::vector<BenchmarkResult> results;
+  auto run = [&](std::string_view name, auto &&body) {
+    if (name.find(filter) == std::string_view::npos) {
+      return;
+    }
+    results.push_back(runBenchmark(name, min_time, body));
+    const BenchmarkResult &result = results.back();
+    std::cout << std::left << std::setw(20) << result.name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(1)
+              << result.seconds * 1e9 / result.operations << " ns/op"
+              << std::setw(16) << std::setprecision(0)
+              << result.operations / result.seconds << " ops/s\n";
+  };
+
+  std::vector<Move> moves;
+  moves.reserve(256);
+
+  run("movegen", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (Board &board : fixture.boards) {
+        moves.clear();
+        MoveExplorer::searchAllMoves(board, board.getPlayerTurn(), moves);
+        checksum += moves.size();
+        operations++;
+      }
+    }
+    return operations;
+  });
+
+  run("make_unmake", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    UndoMove undo_move;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (std::size_t i = 0; i < fixture.boards.size(); i++) {
+        Board &board = fixture.boards[i];
+        for (const Move &move : fixture.moves[i]) {
+          board.makeMove(move, undo_move);
+          checksum += board.getHash();
+          board.unmakeMove(undo_move);
+        }
+        operations += fixture.moves[i].size();
+      }
+    }
+    return operations;
+  });
+
+  run("perft_make_unmake", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (std::size_t i = 0; i < fixture.boards.size(); i++) {
+        Board &board = fixture.boards[i];
+        operations +=
+            replayTree(board, fixture.trees[i], 0, fixture.trees[i].size());
+        checksum += board.getHash();
+      }
+    }
+    return operations;
+  });
+
+  // full perft, leaf nodes per second with either way of making moves
+  run("perft", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (Board &board : fixture.boards) {
+        operations += TreeSearch::search(board, REPLAY_DEPTH);
+      }
+    }
+    return operations;
+  });
+
+  run("perft_copy_make", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (const Board &board : fixture.boards) {
+        operations += TreeSearch::searchCopyMake(board, REPLAY_DEPTH);
+      }
+    }
+    return operations;
+  });
+
+  run("is_under_check", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (const Board &board : fixture.boards) {
+        const bool turn = board.getPlayerTurn();
+        checksum +=
+            board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn);
+        operations++;
+      }
+    }
+    return operations;
+  });
+
+  run("evaluate", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (const Board &board : fixture.boards) {
+        checksum += Evaluate::evaluateBoard(board);
+        operations++;
+      }
+    }
+    return operations;
+  });
+
+  run("fen_parse", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    Board board;
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (const std::string_view fen : fens) {
+        checksum += board.setFen(fen);
+        operations++;
+      }
+    }
+    return operations;
+  });
+
+  run("fen_serialize", [&](uint64_t rounds) {
+    uint64_t operations = 0;
+    char out[Board::MAX_FEN_LENGTH];
+    for (uint64_t round = 0; round < rounds; round++) {
+      for (const Board &board : fixture.boards) {
+        checksum += board.toFen(out);
+        operations++;
+      }
+    }
+    return operations;
+  });
+
+  return results;
+}
+
+void writeJson(std::ostream &out, const std::vector<BenchmarkResult> &results) {
+  out << "{\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &result = results[i];
+    out << "    {\"name\": \"" << result.name
+        << "\", \"operations\": " << result.operations
+        << ", \"ns_per_op\": " << std::fixed << std::setprecision(3)
+        << result.seconds * 1e9 / result.operations
+        << ", \"ops_per_second\": " << std::setprecision(0)
+        << result.operations / result.seconds << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string_view filter;
+  std::string json_path;
+  double min_time = 0.5;
+
+  for (int32_t i = 1; i < argc; i += 2) {
+    const std::string_view argument = argv[i];
+    if (argument == "--filter" && i + 1 < argc) {
+      filter = argv[i + 1];
+    } else if (argument == "--min-time" && i + 1 < argc) {
+      min_time = std::max(std::atof(argv[i + 1]), 0.001);
+    } else if (argument == "--json" && i + 1 < argc) {
+      json_path = argv[i + 1];
+    } else {
+      std::cerr << "usage: bench [--filter substring] [--min-time seconds] "
+                   "[--json file]\n";
+      return 1;
+    }
+  }
+
+  Fixture fixture;
+
+  const std::vector<BenchmarkResult> results =
+      runAll(fixture, filter, min_time);
+
+  if (!json_path.empty()) {
+    std::ofstream json_file(json_path);
+    writeJson(json_file, results);
+  }
+
+  std::cerr << "checksum " << checksum << "\n";
+  return 0;
+}
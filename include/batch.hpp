@@ -0,0 +1,54 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Batch {
+enum class Mode {
+  PERFT,
+  SEARCH,
+};
+
+enum class Format {
+  CSV,
+  JSONL,
+};
+
+struct Options {
+  std::string input_path;
+  // empty for stdout
+  std::string output_path;
+  int32_t threads = 1;
+
+  Mode mode = Mode::PERFT;
+  // perft depth or search depth
+  int32_t depth = 1;
+  // search node limit, 0 means no limit
+  uint64_t nodes = 0;
+  // transposition table size of each worker in search mode
+  std::size_t hash_mb = 16;
+
+  Format format = Format::CSV;
+  // positions in flight, bounds both the work queue and the reorder buffer
+  std::size_t window = 1024;
+};
+
+// the FEN fields of an EPD line, operations and perft annotations dropped
+std::string_view epdPosition(std::string_view line);
+
+// parses the arguments that follow "batch", returns false on bad input
+bool parseOptions(int argc, char **argv, Options &options);
+void printUsage();
+
+/*
+ * Streams the EPD/FEN file line by line through a pool of workers,
+ * each with its own Board, and writes one result per position in
+ * input order. Returns the process exit code.
+ */
+int32_t run(const Options &options);
+}; // namespace Batch
+
+#endif // !BATCH_H
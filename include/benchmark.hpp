@@ -0,0 +1,18 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+
+namespace Benchmark {
+constexpr int32_t DEFAULT_DEPTH = 5;
+
+/*
+ * Searches a fixed list of positions to the given depth with a fresh
+ * transposition table each, and prints the total node count, time and
+ * NPS. With one thread the node count is a signature of the search:
+ * it only changes when search behaviour changes.
+ */
+void run(int32_t depth, int32_t threads);
+}; // namespace Benchmark
+
+#endif // !BENCHMARK_H
@@ -1,8 +1,13 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <span>
+#include <string_view>
+#include <type_traits>
 
 struct Move;
 struct UndoMove;
@@ -23,21 +28,36 @@ enum class SquareType : int8_t {
   EMPTY = 12,
 };
 
-class Board {
+/*
+ * Aligned to a cache line, with the fields read on every node (occupancy,
+ * side to move, en passant, castling) packed into the first line.
+ */
+class alignas(64) Board {
 public:
   static constexpr int8_t BOARD_ROWS = 8;
   static constexpr int8_t BOARD_COLS = 8;
   static constexpr int8_t ALL_PIECE_TYPES = 6;
+  // longest possible FEN plus a terminating null
+  static constexpr std::size_t MAX_FEN_LENGTH = 96;
 
   Board();
 
-  Board(std::string fen_string);
+  // throws std::invalid_argument if the FEN is malformed
+  Board(std::string_view fen);
 
-  static inline uint64_t getPositionAsBitboard(int8_t row, int8_t col) {
+  /*
+   * Parses a FEN without allocating. The move counters are optional.
+   * Returns false if the FEN is malformed, the board is then unusable.
+   */
+  bool setFen(std::string_view fen);
+  // writes the FEN with a terminating null, returns its length
+  std::size_t toFen(char (&out)[MAX_FEN_LENGTH]) const;
+
+  static constexpr uint64_t getPositionAsBitboard(int8_t row, int8_t col) {
     return (uint64_t{1} << (row * BOARD_COLS + col));
   }
-  static inline uint64_t shiftPosition(uint64_t pos, int8_t dir,
-                                       uint64_t mask) {
+  static constexpr uint64_t shiftPosition(uint64_t pos, int8_t dir,
+                                          uint64_t mask) {
     if (dir < 0) {
       return (pos & (~mask)) >> (-dir);
     } else {
@@ -47,44 +67,94 @@ public:
 
   void displayBoard() const;
 
-  static uint64_t chessSquareAsPosition(std::string chess_square);
-  static std::string positionAsChessSquare(uint64_t pos);
+  // returns 0 for "-" and for anything that is not a square
+  static uint64_t chessSquareAsPosition(std::string_view chess_square);
+  /*
+   * writes the square ("-" if pos is 0) without a terminating null,
+   * returns the position after the last written character
+   */
+  static char *positionAsChessSquare(uint64_t pos, char *out);
 
   void makeMove(const Move &move_to_make, UndoMove &undo_move);
+  // copy-make: the move cannot be taken back, the board is a throwaway copy
+  void makeMove(const Move &move_to_make);
 
   void unmakeMove(const UndoMove &undo_move);
 
-  void makeMove(const std::string &move_to_make);
+  // parses a move in UCI notation,
+  // returns false if the move is not legal in the current position
+  bool parseMove(std::string_view uci_move, Move &move);
+  bool makeMove(std::string_view move_to_make);
 
-  inline bool isCellNotEmpty(uint64_t to_pos, bool turn) const {
-    int64_t res = 0;
-    for (int32_t i = 0; i < ALL_PIECE_TYPES; i++) {
-      res |= _pieces[turn][i];
-    }
+  inline uint64_t getAllPieces(bool turn) const { return _occupancy[turn]; }
 
-    return static_cast<bool>(res & to_pos);
+  inline bool isCellNotEmpty(uint64_t to_pos, bool turn) const {
+    return static_cast<bool>(getAllPieces(turn) & to_pos);
   }
 
-  inline void recomputePiecesPositions() {
-    // _all_pieces[0] = _pieces[0][0] | _pieces[0][1] | _pieces[0][2] |
-    //                  _pieces[0][3] | _pieces[0][4] | _pieces[0][5];
-    //
-    // _all_pieces[1] = _pieces[1][0] | _pieces[1][1] | _pieces[1][2] |
-    //                  _pieces[1][3] | _pieces[1][4] | _pieces[1][5];
-  }
+  // rebuilds the occupancy and the square lookup from the bitboards
+  void recomputePiecesPositions();
 
+  /*
+   * Pieces of the opponent of turn that attack square, with sliders
+   * blocked by occupancy
+   */
+  uint64_t attackersTo(int8_t square, bool turn, uint64_t occupancy) const;
   bool isUnderCheck(uint64_t pos_to_check, bool turn) const;
+  // pieces giving check to the side to move, kept up to date by makeMove
+  uint64_t getCheckers() const { return _checkers; }
+  bool isInCheck() const { return _checkers != 0; }
   bool isEnPassant(uint64_t pos, bool turn) const;
+  // true if any of squares is attacked by the opponent of turn
+  bool isAnyAttacked(uint64_t squares, bool turn) const;
   // 1 - short castle ... 0 - long castle
-  bool checkCastlingRights(bool turn, bool castle_type) const;
+  bool checkCastlingRights(bool turn, bool castle_type) const {
+    return _castling_rights & (1 << (turn * 2 + castle_type));
+  }
+  // bit (turn * 2 + castle_type) is set if that castle is still allowed
+  uint8_t getCastlingRights() const { return _castling_rights; }
 
   uint64_t getPiece(int8_t piece_type, bool turn) const;
   bool getPlayerTurn() const;
   uint64_t getLastMoveTwoSquaresPushPawn() const;
 
-  SquareType getPieceOnSquare(int64_t sq) const;
+  SquareType getPieceOnSquare(int64_t sq) const {
+    return sq ? _squares[std::countr_zero(uint64_t(sq))] : SquareType::EMPTY;
+  }
+
+  uint64_t getHash() const;
+  uint64_t computeHash() const;
+
+  uint16_t getHalfmoveClock() const;
+  uint16_t getFullmoveNumber() const;
+
+  /*
+   * True if the position occurred before since the last capture or pawn
+   * move. previous_keys holds the keys of the positions before this one,
+   * oldest first; the board keeps no history so that copying it stays a
+   * flat copy. Only positions with the same side to move are compared.
+   */
+  bool isRepetition(std::span<const uint64_t> previous_keys) const;
 
 private:
+  // first cache line
+  // all pieces of each colour
+  uint64_t _occupancy[2];
+  /*
+   * Set to 0 if last move
+   * was not a two square push from a pawn.
+   * Set to the en passant target square otherwise,
+   * the square the pawn passed over
+   */
+  uint64_t _last_move_two_squares_push_pawn;
+  uint64_t _checkers;
+  // zobrist key, updated incrementally by makeMove
+  uint64_t _hash;
+  uint16_t _halfmove_clock;
+  uint16_t _fullmove_number;
+  uint8_t _castling_rights;
+  bool _player_turn;
+
   /*
    * elements at ind 0 represent white figures, 1 is for black
    * 0 - king
@@ -94,16 +164,16 @@ private:
    * 4 - knight
    * 5 - pawn
    */
-  uint64_t _pieces[2][6];
-  // uint64_t _all_pieces[2];
-  /*
-   * Set to 0 if last move
-   * was not a two square push from a pawn.
-   * Set to the pawn's square otherwise
-   */
-  uint64_t _last_move_two_squares_push_pawn;
-  uint64_t _pieces_not_moved;
-  bool _player_turn;
+  alignas(64) uint64_t _pieces[2][6];
+  // the same pieces indexed by square, so captures need no search
+  SquareType _squares[64];
+
+  void updateCheckers();
+  // the body of both makeMove overloads
+  void applyMove(const Move &move_to_make, UndoMove &undo_move);
 };
 
+// copy-make copies whole boards every ply
+static_assert(std::is_trivially_copyable_v<Board>);
+
 #endif // !BOARD_H
@@ -0,0 +1,64 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "board.hpp"
+#include "move.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+/*
+ * Polyglot opening book. The .bin file is memory-mapped, so opening it
+ * reads nothing and pages are only faulted in by the binary search.
+ * Positions are hashed with the Random64 table of the Polyglot format.
+ */
+class Book {
+public:
+  static constexpr std::size_t RANDOM64_COUNT = 781;
+  static constexpr uint64_t START_POSITION_KEY = 0x463B96181691FC9CULL;
+
+  enum class Selection : uint8_t {
+    // the move with the highest weight
+    BEST,
+    // a random move, chosen with probability proportional to its weight
+    WEIGHTED,
+  };
+
+  Book();
+  ~Book();
+
+  Book(const Book &) = delete;
+  Book &operator=(const Book &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+
+  bool isReady() const;
+
+  static uint64_t polyglotKey(const Board &board);
+
+  // false if the position is not in the book
+  bool probe(const Board &board, Selection selection, Move &move);
+
+private:
+  // the on-disk record, every field is big-endian
+  struct Entry {
+    uint8_t key[8];
+    uint8_t move[2];
+    uint8_t weight[2];
+    uint8_t learn[4];
+  };
+  static_assert(sizeof(Entry) == 16);
+
+  bool toMove(const Board &board, uint16_t polyglot_move, Move &move) const;
+
+  const Entry *_entries;
+  std::size_t _entry_count;
+  std::size_t _mapped_size;
+
+  std::mt19937_64 _rng;
+};
+
+#endif // !BOOK_H
@@ -0,0 +1,122 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "board.hpp"
+#include "transposition-table.hpp"
+#include "tree-search.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class Session;
+
+/*
+ * Embeddable engine: a fixed pool of workers shared by any number of
+ * sessions. Every analysis runs single-threaded on one worker, so many
+ * positions are searched side by side in one process.
+ * The engine must outlive every use of its sessions.
+ * Sessions share the Syzygy tables, which are process-wide: probes are
+ * safe from every worker, but Tablebase::init() must not run while any
+ * session analyzes.
+ */
+class Engine {
+public:
+  // 0 workers means one per hardware thread
+  explicit Engine(int32_t workers = 0);
+  // cancels every analysis, their futures are still fulfilled
+  ~Engine();
+
+  Engine(const Engine &) = delete;
+  Engine &operator=(const Engine &) = delete;
+
+  /*
+   * A new session on the start position, thread-safe. Each session owns
+   * a transposition table of hash_mb megabytes, rounded up to whole
+   * 2MB huge pages, for as long as it lives.
+   */
+  std::shared_ptr<Session> createSession(std::size_t hash_mb);
+  std::shared_ptr<Session> createSession();
+
+  int32_t workerCount() const;
+
+private:
+  friend class Session;
+
+  void submit(std::function<void()> job);
+  void workerLoop();
+
+  std::mutex _mutex;
+  std::condition_variable _job_available;
+  std::deque<std::function<void()>> _jobs;
+  bool _shutting_down = false;
+  // cancelled on shutdown, expired entries are dropped on creation
+  std::vector<std::weak_ptr<Session>> _sessions;
+  std::vector<std::thread> _workers;
+};
+
+/*
+ * One independent analysis context with its own position and
+ * transposition table. Every method may be called from any thread.
+ */
+class Session : public std::enable_shared_from_this<Session> {
+public:
+  // small enough that thousands of sessions fit in memory
+  static constexpr std::size_t DEFAULT_HASH_MB = 2;
+
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  /*
+   * Sets the position from a FEN and the UCI moves played from it.
+   * Returns false and keeps the old position if either is invalid.
+   */
+  bool setPosition(std::string_view fen,
+                   const std::vector<std::string> &moves = {});
+  std::string getFen() const;
+
+  /*
+   * Queues a search of the current position on the engine's workers.
+   * Later position changes do not affect it. report is called from the
+   * worker after every completed iteration. Infinite searches only end
+   * on cancel.
+   */
+  std::future<TreeSearch::SearchResult>
+  analyze(const TreeSearch::SearchLimits &limits,
+          TreeSearch::ReportCallback report = nullptr);
+
+  /*
+   * Stops the running and queued analyses of this session. Their futures
+   * get the best move found so far.
+   */
+  void cancel();
+
+private:
+  friend class Engine;
+
+  Session(Engine &engine, std::size_t hash_mb = DEFAULT_HASH_MB);
+
+  Engine &_engine;
+
+  mutable std::mutex _mutex;
+  Board _board;
+  // keys of the positions before _board, oldest first
+  std::vector<uint64_t> _key_history;
+  // stop flags of the queued and running analyses
+  std::vector<std::shared_ptr<std::atomic<bool>>> _stop_flags;
+
+  // shared by all analyses of the session, it needs no locking
+  TranspositionTable _tt;
+};
+
+#endif // !ENGINE_H
@@ -6,7 +6,6 @@
 class Board;
 
 namespace Evaluate {
-void initTables();
 int32_t evaluateBoard(const Board &board);
 }; // namespace Evaluate
 
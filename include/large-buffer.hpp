@@ -0,0 +1,46 @@
+#ifndef LARGE_BUFFER_H
+#define LARGE_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Memory for big tables such as the transposition table.
+ * The buffer is 2MB aligned and asks the kernel for transparent huge
+ * pages to cut TLB misses, falling back to plain aligned memory when
+ * mmap is refused. Throws std::bad_alloc if no memory can be had.
+ */
+class LargeBuffer {
+public:
+  static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+  LargeBuffer() = default;
+  explicit LargeBuffer(std::size_t bytes);
+  ~LargeBuffer();
+
+  LargeBuffer(LargeBuffer &&other) noexcept;
+  LargeBuffer &operator=(LargeBuffer &&other) noexcept;
+  LargeBuffer(const LargeBuffer &) = delete;
+  LargeBuffer &operator=(const LargeBuffer &) = delete;
+
+  void *data() const { return _data; }
+  std::size_t size() const { return _size; }
+
+  /*
+   * Zeroes the buffer with one thread per chunk. The pages are first
+   * touched by different threads, so on NUMA machines they are spread
+   * over the nodes instead of all landing next to one core.
+   * 0 threads means one per hardware thread.
+   */
+  void zero(int32_t threads = 0);
+
+private:
+  void release();
+
+  void *_data = nullptr;
+  std::size_t _size = 0;
+  // false when the fallback allocator was used
+  bool _mapped = false;
+};
+
+#endif // !LARGE_BUFFER_H
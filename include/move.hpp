@@ -4,6 +4,8 @@
 #include "board.hpp"
 #include "util.hpp"
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -19,31 +21,59 @@ struct Move {
       : pos_from(pos_from_), pos_to(pos_to_), piece_type(piece_type_),
         move_type(move_type_) {}
 
-  std::string formatted() const {
+  bool operator==(const Move &other) const {
+    return pos_from == other.pos_from && pos_to == other.pos_to &&
+           move_type == other.move_type;
+  }
 
-    std::string from_str = Board::positionAsChessSquare(pos_from);
-    std::string to_str = Board::positionAsChessSquare(pos_to);
+  /*
+   * 6 bits from square, 6 bits to square,
+   * 4 bits move type and 3 bits piece type
+   */
+  uint32_t pack() const {
+    return uint32_t(std::countr_zero(pos_from)) |
+           (uint32_t(std::countr_zero(pos_to)) << 6) |
+           (uint32_t(move_type) << 12) | (uint32_t(piece_type) << 16);
+  }
+
+  static Move unpack(uint32_t packed) {
+    return Move{uint64_t{1} << (packed & 63),
+                uint64_t{1} << ((packed >> 6) & 63), Pieces((packed >> 16) & 7),
+                MoveType((packed >> 12) & 15)};
+  }
 
-    std::string addition = "";
+  // "e7e8q" plus a terminating null
+  static constexpr std::size_t MAX_FORMATTED_LENGTH = 5;
+
+  // writes the move in UCI notation, returns the length without the null
+  std::size_t format(char (&out)[MAX_FORMATTED_LENGTH + 1]) const {
+    char *end = Board::positionAsChessSquare(pos_from, out);
+    end = Board::positionAsChessSquare(pos_to, end);
 
     switch (move_type) {
     case MoveType::PAWN_PROMOTE_QUEEN:
-      addition = "q";
+      *end++ = 'q';
       break;
     case MoveType::PAWN_PROMOTE_ROOK:
-      addition = "r";
+      *end++ = 'r';
       break;
     case MoveType::PAWN_PROMOTE_BISHOP:
-      addition = "b";
+      *end++ = 'b';
       break;
     case MoveType::PAWN_PROMOTE_KNIGHT:
-      addition = "n";
+      *end++ = 'n';
       break;
     default:
       break;
     }
 
-    return from_str + to_str + addition;
+    *end = '\0';
+    return end - out;
+  }
+
+  std::string formatted() const {
+    char out[MAX_FORMATTED_LENGTH + 1];
+    return std::string(out, format(out));
   }
 };
 
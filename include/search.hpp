@@ -5,6 +5,7 @@
 #include "move.hpp"
 
 #include <array>
+#include <bit>
 #include <vector>
 
 namespace MoveExplorer {
@@ -36,14 +37,48 @@ constexpr uint64_t ROW_SIX_SEVEN = ROW_SIX | ROW_SEVEN;
 
 //-------------------------------------------------------------------------------------------------------------------------
 
-const uint64_t rook_from[2][2] = {
+constexpr uint64_t rook_from[2][2] = {
     {Board::getPositionAsBitboard(0, 0), Board::getPositionAsBitboard(0, 7)},
     {Board::getPositionAsBitboard(7, 0), Board::getPositionAsBitboard(7, 7)}};
 
-const uint64_t rook_to[2][2] = {
+constexpr uint64_t rook_to[2][2] = {
     {Board::getPositionAsBitboard(0, 3), Board::getPositionAsBitboard(0, 5)},
     {Board::getPositionAsBitboard(7, 3), Board::getPositionAsBitboard(7, 5)}};
 
+// indexed [colour][castle_type] like rook_from, 1 - short castle
+constexpr uint64_t castle_king_to[2][2] = {
+    {Board::getPositionAsBitboard(0, 2), Board::getPositionAsBitboard(0, 6)},
+    {Board::getPositionAsBitboard(7, 2), Board::getPositionAsBitboard(7, 6)}};
+
+// squares between the king and the rook
+constexpr uint64_t castle_empty[2][2] = {{0x000000000000000EULL,
+                                          0x0000000000000060ULL},
+                                         {0x0E00000000000000ULL,
+                                          0x6000000000000000ULL}};
+
+// squares the king passes over or lands on, its own square is covered by
+// the check test
+constexpr uint64_t castle_safe[2][2] = {{0x000000000000000CULL,
+                                         0x0000000000000060ULL},
+                                        {0x0C00000000000000ULL,
+                                         0x6000000000000000ULL}};
+
+// castling rights kept when a move starts or ends on the square
+constexpr std::array<uint8_t, 64> generateCastlingRightsMasks() {
+  std::array<uint8_t, 64> masks{};
+  masks.fill(0xF);
+  for (int8_t colour = 0; colour < 2; colour++) {
+    const int8_t row = colour ? 7 : 0;
+    masks[row * 8 + 0] &= ~(1 << (colour * 2 + 0));
+    masks[row * 8 + 7] &= ~(1 << (colour * 2 + 1));
+    masks[row * 8 + 4] &= ~(3 << (colour * 2));
+  }
+  return masks;
+}
+
+constexpr std::array<uint8_t, 64> castling_rights_masks =
+    generateCastlingRightsMasks();
+
 //-------------------------------------------------------------------------------------------------------------------------
 
 constexpr std::array<int8_t, 4> move_diag_shifts = {-9, -7, +7, +9};
@@ -82,6 +117,102 @@ constexpr std::array<uint64_t, 8> knight_move_shifts_masks = {
     ROW_ONE_TWO | FILE_A, ROW_ONE_TWO | FILE_H,   ROW_ONE | FILE_GH,
     ROW_SEVEN | FILE_GH,  ROW_SIX_SEVEN | FILE_H, ROW_SIX_SEVEN | FILE_A,
     ROW_SEVEN | FILE_AB,  ROW_ONE | FILE_AB};
+
+//-------------------------------------------------------------------------------------------------------------------------
+
+// every square a leaper reaches from each square, built at compile time
+template <std::size_t N>
+constexpr std::array<uint64_t, 64>
+generateLeaperAttacks(const std::array<int8_t, N> &move_shift,
+                      const std::array<uint64_t, N> &move_shift_mask) {
+  std::array<uint64_t, 64> attacks{};
+  for (int8_t square = 0; square < 64; square++) {
+    for (std::size_t i = 0; i < N; i++) {
+      attacks[square] |= Board::shiftPosition(
+          uint64_t{1} << square, move_shift[i], move_shift_mask[i]);
+    }
+  }
+  return attacks;
+}
+
+// every square a slider reaches from each square on an empty board
+template <std::size_t N>
+constexpr std::array<uint64_t, 64>
+generateRays(const std::array<int8_t, N> &move_shift,
+             const std::array<uint64_t, N> &move_shift_mask) {
+  std::array<uint64_t, 64> rays{};
+  for (int8_t square = 0; square < 64; square++) {
+    for (std::size_t i = 0; i < N; i++) {
+      uint64_t position = Board::shiftPosition(
+          uint64_t{1} << square, move_shift[i], move_shift_mask[i]);
+      while (position) {
+        rays[square] |= position;
+        position =
+            Board::shiftPosition(position, move_shift[i], move_shift_mask[i]);
+      }
+    }
+  }
+  return rays;
+}
+
+constexpr std::array<uint64_t, 64> line_rays =
+    generateRays(move_line_shifts, move_line_shifts_masks);
+
+constexpr std::array<uint64_t, 64> diag_rays =
+    generateRays(move_diag_shifts, move_diag_shifts_masks);
+
+// empty-board rays for each of the combined_shifts directions
+constexpr std::array<std::array<uint64_t, 64>, 8> generateDirectionRays() {
+  std::array<std::array<uint64_t, 64>, 8> rays{};
+  for (std::size_t i = 0; i < combined_shifts.size(); i++) {
+    rays[i] = generateRays(std::array<int8_t, 1>{combined_shifts[i]},
+                           std::array<uint64_t, 1>{combined_shifts_masks[i]});
+  }
+  return rays;
+}
+
+constexpr std::array<std::array<uint64_t, 64>, 8> direction_rays =
+    generateDirectionRays();
+
+// squares a slider on square reaches in one direction, up to the blocker
+constexpr uint64_t rayAttacks(std::size_t direction, int8_t square,
+                              uint64_t occupancy) {
+  uint64_t ray = direction_rays[direction][square];
+  const uint64_t blockers = ray & occupancy;
+  if (blockers) {
+    const int8_t blocker = combined_shifts[direction] > 0
+                               ? std::countr_zero(blockers)
+                               : 63 - std::countl_zero(blockers);
+    ray ^= direction_rays[direction][blocker];
+  }
+  return ray;
+}
+
+constexpr uint64_t bishopAttacks(int8_t square, uint64_t occupancy) {
+  return rayAttacks(0, square, occupancy) | rayAttacks(1, square, occupancy) |
+         rayAttacks(2, square, occupancy) | rayAttacks(3, square, occupancy);
+}
+
+constexpr uint64_t rookAttacks(int8_t square, uint64_t occupancy) {
+  return rayAttacks(4, square, occupancy) | rayAttacks(5, square, occupancy) |
+         rayAttacks(6, square, occupancy) | rayAttacks(7, square, occupancy);
+}
+
+constexpr std::array<uint64_t, 64> knight_attacks =
+    generateLeaperAttacks(knight_move_shifts, knight_move_shifts_masks);
+
+constexpr std::array<uint64_t, 64> king_attacks =
+    generateLeaperAttacks(combined_shifts, combined_shifts_masks);
+
+// indexed by colour, the squares a pawn of that colour captures on
+constexpr std::array<uint64_t, 64> pawn_attacks[2] = {
+    generateLeaperAttacks(std::array<int8_t, 2>{+7, +9},
+                          std::array<uint64_t, 2>{FILE_A | ROW_SEVEN,
+                                                  FILE_H | ROW_SEVEN}),
+    generateLeaperAttacks(std::array<int8_t, 2>{-9, -7},
+                          std::array<uint64_t, 2>{FILE_A | ROW_ONE,
+                                                  FILE_H | ROW_ONE}),
+};
 }; // namespace MoveExplorer
 
 #endif // !SEARCH_H
@@ -0,0 +1,81 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Hot-path counters, compiled in with -DENABLE_STATS=ON.
+ * Every thread owns its counters, so counting is a plain load and store
+ * without contention. When compiled out every call is an empty inline
+ * function and costs nothing.
+ */
+namespace Stats {
+enum Counter : uint8_t {
+  KING_MOVES,
+  QUEEN_MOVES,
+  ROOK_MOVES,
+  BISHOP_MOVES,
+  KNIGHT_MOVES,
+  PAWN_MOVES,
+  // pseudo-legal moves dropped because they leave the king in check
+  GENERATE_MOVES_REJECTED,
+  MOVE_INCREMENTALLY_REJECTED,
+  PAWN_MOVES_REJECTED,
+  IS_UNDER_CHECK,
+  MAKE_MOVE,
+  UNMAKE_MOVE,
+  TT_PROBES,
+  TT_HITS,
+  TB_HITS,
+  COUNTER_COUNT,
+};
+
+// beta cutoffs by the index of the cutting move, the last bucket is 15+
+constexpr int32_t CUTOFF_BUCKETS = 16;
+
+#ifdef ELOCONQUEROR_STATS
+constexpr bool ENABLED = true;
+
+struct ThreadCounters {
+  ThreadCounters();
+  ~ThreadCounters();
+
+  std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+  std::atomic<uint64_t> cutoffs[CUTOFF_BUCKETS] = {};
+};
+
+ThreadCounters &local();
+
+inline void bump(std::atomic<uint64_t> &counter, uint64_t amount) {
+  // only the owning thread writes, readers tolerate a stale value
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+inline void add(Counter counter, uint64_t amount = 1) {
+  bump(local().counters[counter], amount);
+}
+
+inline void addCutoff(std::size_t move_index) {
+  bump(local().cutoffs[move_index < CUTOFF_BUCKETS ? move_index
+                                                   : CUTOFF_BUCKETS - 1],
+       1);
+}
+
+// sums the counters of running and finished threads
+void print(std::ostream &out);
+void reset();
+#else
+constexpr bool ENABLED = false;
+
+inline void add(Counter, uint64_t = 1) {}
+inline void addCutoff(std::size_t) {}
+inline void print(std::ostream &) {}
+inline void reset() {}
+#endif
+}; // namespace Stats
+
+#endif // !STATS_H
@@ -0,0 +1,49 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "board.hpp"
+#include "move.hpp"
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Syzygy probing through Fathom, built in when CMake is given
+ * -DENABLE_SYZYGY=ON and a pinned FATHOM_GIT_TAG. Fathom memory-maps each
+ * table file the first time it is probed. Without it init() fails and nothing is ever probed.
+ * The tables are process-wide: init() must not run while anything probes.
+ */
+namespace Tablebase {
+enum class Wdl : uint8_t {
+  LOSS,
+  // lost, but drawn by the fifty-move rule
+  BLESSED_LOSS,
+  DRAW,
+  // won, but drawn by the fifty-move rule
+  CURSED_WIN,
+  WIN,
+};
+
+// an empty path unloads the tables
+bool init(const std::string &path);
+// most pieces of any loaded table, 0 if none are loaded
+int32_t largest();
+
+int32_t pieceCount(const Board &board);
+
+/*
+ * Win/draw/loss from the side to move's point of view. Tables only hold
+ * positions without castling rights, right after a capture or pawn move.
+ * Safe to call from several threads.
+ */
+bool probeWdl(const Board &board, Wdl &wdl);
+
+/*
+ * Picks the move that keeps the best result with the shortest distance
+ * to zeroing. Fathom's root probe is not reentrant, so concurrent calls
+ * are serialized.
+ */
+bool probeRoot(const Board &board, Move &move, Wdl &wdl);
+}; // namespace Tablebase
+
+#endif // !TABLEBASE_H
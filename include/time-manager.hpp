@@ -0,0 +1,59 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include "move.hpp"
+#include "tree-search.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Splits the clock into a soft limit, checked between iterations, and a
+ * hard limit, checked inside the search. The clock is only read every
+ * few nodes, with the interval derived from the measured node rate.
+ */
+class TimeManager {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // reserved for communication with the GUI
+  static constexpr int64_t MOVE_OVERHEAD_MS = 30;
+
+  TimeManager(const TreeSearch::SearchLimits &limits, bool turn);
+
+  // called by the main thread on every node
+  inline bool hardLimitReached(uint64_t nodes) {
+    if (nodes < _next_check) {
+      return false;
+    }
+    return pollClock(nodes);
+  }
+
+  // called after every completed iteration with its best move
+  bool softLimitReached(const Move &best_move);
+
+  // starts the clock over, on ponderhit
+  void restart(uint64_t nodes);
+
+  bool hasTimeLimit() const;
+  int64_t elapsedMs() const;
+  int64_t softLimitMs() const;
+  int64_t hardLimitMs() const;
+
+private:
+  bool pollClock(uint64_t nodes);
+
+  Clock::time_point _start_time;
+  std::chrono::microseconds _soft_limit;
+  std::chrono::microseconds _hard_limit;
+  bool _has_time_limit;
+  // movetime, use all of it regardless of stability
+  bool _fixed_time;
+
+  uint64_t _next_check;
+
+  Move _last_best_move;
+  int32_t _stable_iterations;
+};
+
+#endif // !TIME_MANAGER_H
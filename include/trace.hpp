@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Scoped timers for profiling, compiled in with -DENABLE_TRACE=ON.
+ * Even then nothing is recorded until enable() is called, which main does
+ * when ELOCONQUEROR_TRACE names an output file. Every thread writes into
+ * its own ring buffer, keeping the most recent events, and dump() writes
+ * the buffers as Chrome trace_event JSON.
+ */
+namespace Trace {
+#ifdef ELOCONQUEROR_TRACE
+constexpr bool ENABLED = true;
+
+extern std::atomic<bool> recording;
+
+int64_t now();
+void record(const char *name, int64_t start, int64_t end);
+
+// name must be a string literal, only the pointer is stored
+class Scope {
+public:
+  explicit Scope(const char *name)
+      : _name(name),
+        _start(recording.load(std::memory_order_relaxed) ? now() : -1) {}
+  ~Scope() {
+    if (_start >= 0) {
+      record(_name, _start, now());
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  const char *_name;
+  int64_t _start;
+};
+
+// starts recording, the trace goes to path once dump() is called
+bool enable(const char *path);
+/*
+ * Stops recording and writes the trace. The rings are read without
+ * synchronizing with their threads, so every thread that recorded must
+ * have been joined first.
+ */
+void dump();
+#else
+constexpr bool ENABLED = false;
+
+class Scope {
+public:
+  explicit Scope(const char *) {}
+};
+
+inline bool enable(const char *) { return false; }
+inline void dump() {}
+#endif
+}; // namespace Trace
+
+#endif // !TRACE_H
@@ -0,0 +1,62 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include "large-buffer.hpp"
+#include "move.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class Bound : uint8_t {
+  NONE = 0,
+  UPPER = 1,
+  LOWER = 2,
+  EXACT = 3,
+};
+
+struct TTEntry {
+  Move move;
+  bool has_move;
+  int32_t score;
+  int32_t depth;
+  Bound bound;
+};
+
+/*
+ * Shared between search threads without locking.
+ * Each slot stores the key xor-ed with its data, so a torn
+ * write from two threads fails the key check on probe.
+ */
+class TranspositionTable {
+public:
+  static constexpr std::size_t DEFAULT_SIZE_MB = 16;
+
+  explicit TranspositionTable(std::size_t megabytes = DEFAULT_SIZE_MB);
+
+  // throws std::bad_alloc and keeps the current table if out of memory
+  void resize(std::size_t megabytes);
+  void clear();
+
+  // depths past MAX_DEPTH are stored as MAX_DEPTH
+  static constexpr int32_t MAX_DEPTH = INT8_MAX;
+
+  bool probe(uint64_t key, TTEntry &entry) const;
+  void store(uint64_t key, int32_t depth, int32_t score, Bound bound,
+             const Move *move);
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> key_xor_data;
+    std::atomic<uint64_t> data;
+  };
+
+  inline Slot &slotFor(uint64_t key) const { return _slots[key & _mask]; }
+
+  LargeBuffer _memory;
+  // points into _memory
+  Slot *_slots;
+  std::size_t _mask;
+};
+
+#endif // !TRANSPOSITION_TABLE_H
@@ -2,9 +2,88 @@
 #define TREE_SEARCH_H
 
 #include "board.hpp"
+#include "move.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+class TranspositionTable;
 
 namespace TreeSearch {
+constexpr int32_t MAX_PLY = 128;
+constexpr int32_t INF_SCORE = 32'000;
+constexpr int32_t MATE_SCORE = 31'000;
+// scores above this are mates found within MAX_PLY
+constexpr int32_t MATE_BOUND = MATE_SCORE - MAX_PLY;
+// tablebase wins, below every mate score
+constexpr int32_t TB_WIN_SCORE = MATE_BOUND - MAX_PLY;
+
+struct SearchLimits {
+  int32_t depth = MAX_PLY - 1;
+  // 0 means no limit for all of the fields below
+  uint64_t nodes = 0;
+  int64_t move_time = 0; // milliseconds
+  // indexed by colour, milliseconds
+  int64_t time_left[2] = {0, 0};
+  int64_t increment[2] = {0, 0};
+  int32_t moves_to_go = 0;
+  // keep searching until stopped, even after reaching the depth limit
+  bool infinite = false;
+  // probe tablebases with at most this many pieces, 0 disables probing
+  int32_t syzygy_probe_limit = 0;
+};
+
+struct SearchReport {
+  int32_t depth;
+  int32_t sel_depth;
+  int32_t score;
+  uint64_t nodes;
+  int64_t elapsed_ms;
+  std::vector<Move> pv;
+};
+
+struct SearchResult {
+  // pos_from is 0 if the side to move has no legal moves
+  Move best_move{};
+  // pos_from is 0 if the principal variation is a single move
+  Move ponder_move{};
+  int32_t score = 0;
+  int32_t depth = 0;
+  uint64_t nodes = 0;
+};
+
+using ReportCallback = std::function<void(const SearchReport &)>;
+
+// perft, counts the leaf nodes at the given depth
 uint64_t search(Board &board, int32_t depth);
-}
+/*
+ * perft with copy-make, every ply gets its own copy of the board to make
+ * the move on instead of taking moves back
+ */
+uint64_t searchCopyMake(const Board &board, int32_t depth);
+
+/*
+ * Iterative deepening alpha-beta search.
+ * Runs threads - 1 helper threads sharing the transposition table.
+ * Returns once a limit is hit or stop is set; stop is left set on return.
+ * report is called by the main thread after every completed iteration.
+ *
+ * While ponder is set the search ignores its limits and does not return
+ * before stop. Clearing ponder is a ponderhit: the clock starts then and
+ * the same search carries on under the limits.
+ *
+ * history holds the keys of the game positions before board, oldest
+ * first, so repetitions of earlier positions are seen.
+ */
+SearchResult findBestMove(const Board &board, const SearchLimits &limits,
+                          TranspositionTable &tt, std::atomic<bool> &stop,
+                          int32_t threads = 1,
+                          const ReportCallback &report = nullptr,
+                          const std::atomic<bool> *ponder = nullptr,
+                          std::span<const uint64_t> history = {});
+} // namespace TreeSearch
 
 #endif // !TREE_SEARCH_H
@@ -0,0 +1,9 @@
+#ifndef UCI_H
+#define UCI_H
+
+namespace UCI {
+// reads commands from stdin until "quit" or end of input
+void loop();
+}; // namespace UCI
+
+#endif // !UCI_H
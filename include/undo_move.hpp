@@ -8,11 +8,16 @@ struct UndoMove {
   uint64_t prev_enpassant_pos;
   uint64_t from_pos;
   uint64_t to_pos;
-  uint64_t pieces_not_moved;
+  uint64_t hash;
+  uint64_t checkers;
+  uint16_t halfmove_clock;
+  uint8_t castling_rights;
 
   int8_t piece_type;
 
+  // -1 if nothing was taken
   int8_t taken_piece;
+  int8_t taken_square;
   MoveType move_type;
 };
 
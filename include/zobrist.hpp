@@ -0,0 +1,54 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+
+namespace Zobrist {
+/*
+ * Keys are produced at compile time with splitmix64 so that hashes
+ * stay identical between builds and runs.
+ */
+constexpr uint64_t splitMix64(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+struct Keys {
+  // [colour][piece_type][square]
+  uint64_t pieces[2][6][64];
+  // indexed by the 4-bit castling rights mask
+  uint64_t castling[16];
+  // indexed by the file of the en passant square
+  uint64_t en_passant[8];
+  uint64_t black_to_move;
+};
+
+constexpr Keys generateKeys() {
+  Keys keys{};
+  uint64_t state = 0x45C0C0DEULL;
+
+  for (auto &colour : keys.pieces) {
+    for (auto &piece_type : colour) {
+      for (auto &square : piece_type) {
+        square = splitMix64(state);
+      }
+    }
+  }
+  for (auto &key : keys.castling) {
+    key = splitMix64(state);
+  }
+  for (auto &key : keys.en_passant) {
+    key = splitMix64(state);
+  }
+  keys.black_to_move = splitMix64(state);
+
+  return keys;
+}
+
+inline constexpr Keys keys = generateKeys();
+}; // namespace Zobrist
+
+#endif // !ZOBRIST_H
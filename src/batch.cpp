@@ -0,0 +1,327 @@
+#include "batch.hpp"
+#include "board.hpp"
+#include "move.hpp"
+#include "transposition-table.hpp"
+#include "tree-search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Job {
+  uint64_t index;
+  std::string line;
+};
+
+/*
+ * Jobs are only handed out while they fit in the reorder window,
+ * so result slots can be indexed modulo the window size.
+ */
+struct Pipeline {
+  explicit Pipeline(std::size_t window_) : window(window_), results(window_) {}
+
+  const std::size_t window;
+
+  std::mutex mutex;
+  std::condition_variable job_available;
+  std::condition_variable result_available;
+  std::condition_variable window_available;
+
+  std::deque<Job> jobs;
+  bool input_done = false;
+
+  std::vector<std::optional<std::string>> results;
+  uint64_t read_count = 0;
+  uint64_t written_count = 0;
+};
+
+// quotes the text as a CSV field or a JSON string
+std::string quote(std::string_view text, Batch::Format format) {
+  std::string quoted = "\"";
+  for (const char letter : text) {
+    if (letter == '"') {
+      quoted += format == Batch::Format::CSV ? "\"\"" : "\\\"";
+    } else if (letter == '\\' && format == Batch::Format::JSONL) {
+      quoted += "\\\\";
+    } else if (uint8_t(letter) >= 0x20) {
+      quoted += letter;
+    }
+  }
+  return quoted + "\"";
+}
+
+// value columns of a CSV row, error rows leave them all empty
+std::string_view csvColumns(Batch::Mode mode) {
+  return mode == Batch::Mode::PERFT ? "nodes" : "bestmove,score,depth,nodes";
+}
+
+std::string formatRow(const Batch::Options &options, uint64_t index,
+                      std::string_view fen, const std::string &error,
+                      const std::string &columns_csv,
+                      const std::string &columns_json) {
+  std::string row;
+  if (options.format == Batch::Format::CSV) {
+    row = std::to_string(index) + "," + quote(fen, options.format) + ",";
+    if (error.empty()) {
+      row += columns_csv;
+    } else {
+      row.append(std::ranges::count(csvColumns(options.mode), ','), ',');
+    }
+    // the last column is the error, empty when the position was analysed
+    row += "," + error;
+  } else {
+    row = "{\"index\":" + std::to_string(index) +
+          ",\"fen\":" + quote(fen, options.format) + ",";
+    row += error.empty() ? columns_json : "\"error\":\"" + error + "\"";
+    row += "}";
+  }
+  return row;
+}
+
+std::string analysePosition(const Batch::Options &options, Board &board,
+                            TranspositionTable *tt, const Job &job) {
+  const std::string_view fen = Batch::epdPosition(job.line);
+  if (!board.setFen(fen)) {
+    return formatRow(options, job.index, fen, "invalid fen", "", "");
+  }
+
+  if (options.mode == Batch::Mode::PERFT) {
+    const std::string nodes =
+        std::to_string(TreeSearch::search(board, options.depth));
+    return formatRow(options, job.index, fen, "", nodes,
+                     "\"nodes\":" + nodes);
+  }
+
+  // a fresh table per position keeps the results reproducible
+  tt->clear();
+  std::atomic<bool> stop{false};
+  TreeSearch::SearchLimits limits;
+  limits.depth = options.depth;
+  limits.nodes = options.nodes;
+
+  const TreeSearch::SearchResult result =
+      TreeSearch::findBestMove(board, limits, *tt, stop);
+  const std::string best_move = result.best_move.pos_from == 0
+                                    ? "0000"
+                                    : result.best_move.formatted();
+
+  return formatRow(
+      options, job.index, fen, "",
+      best_move + "," + std::to_string(result.score) + "," +
+          std::to_string(result.depth) + "," + std::to_string(result.nodes),
+      "\"bestmove\":\"" + best_move +
+          "\",\"score\":" + std::to_string(result.score) +
+          ",\"depth\":" + std::to_string(result.depth) +
+          ",\"nodes\":" + std::to_string(result.nodes));
+}
+
+void worker(const Batch::Options &options, Pipeline &pipeline) {
+  Board board;
+  std::optional<TranspositionTable> tt;
+  if (options.mode == Batch::Mode::SEARCH) {
+    tt.emplace();
+    tt->resize(options.hash_mb);
+  }
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(pipeline.mutex);
+      pipeline.job_available.wait(lock, [&pipeline] {
+        return !pipeline.jobs.empty() || pipeline.input_done;
+      });
+      if (pipeline.jobs.empty()) {
+        return;
+      }
+      job = std::move(pipeline.jobs.front());
+      pipeline.jobs.pop_front();
+    }
+
+    std::string row =
+        analysePosition(options, board, tt ? &*tt : nullptr, job);
+
+    {
+      std::lock_guard<std::mutex> lock(pipeline.mutex);
+      pipeline.results[job.index % pipeline.window] = std::move(row);
+    }
+    pipeline.result_available.notify_one();
+  }
+}
+
+void writer(std::ostream &out, Pipeline &pipeline) {
+  std::unique_lock<std::mutex> lock(pipeline.mutex);
+  while (true) {
+    pipeline.result_available.wait(lock, [&pipeline] {
+      return pipeline.results[pipeline.written_count % pipeline.window] ||
+             (pipeline.input_done &&
+              pipeline.written_count == pipeline.read_count);
+    });
+
+    std::optional<std::string> &slot =
+        pipeline.results[pipeline.written_count % pipeline.window];
+    if (!slot) {
+      return;
+    }
+
+    std::string row = std::move(*slot);
+    slot.reset();
+    pipeline.written_count++;
+
+    // write without holding the lock so workers are not blocked on I/O
+    lock.unlock();
+    pipeline.window_available.notify_one();
+    out << row << '\n';
+    lock.lock();
+  }
+}
+
+bool parseNumber(std::string_view text, auto &value) {
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc{} && end == text.data() + text.size();
+}
+} // namespace
+
+std::string_view Batch::epdPosition(std::string_view line) {
+  line = line.substr(0, line.find(';'));
+
+  std::size_t end = 0;
+  for (int32_t field = 0; field < 6; field++) {
+    const std::size_t field_start = line.find_first_not_of(' ', end);
+    if (field_start == std::string_view::npos) {
+      break;
+    }
+    const std::size_t field_end = std::min(line.find(' ', field_start),
+                                           line.size());
+
+    // the move counters are the only numeric fields
+    if (field >= 4 && !std::isdigit(uint8_t(line[field_start]))) {
+      break;
+    }
+    end = field_end;
+  }
+  return line.substr(0, end);
+}
+
+void Batch::printUsage() {
+  std::cerr << "usage: EloConqueror batch <file.epd> [--threads N] "
+               "[--perft D | --depth D | --nodes N] [--hash MB] "
+               "[--format csv|jsonl] [--output file]\n";
+}
+
+bool Batch::parseOptions(int argc, char **argv, Options &options) {
+  bool has_depth = false;
+
+  for (int32_t i = 0; i < argc; i++) {
+    const std::string_view argument = argv[i];
+    const bool has_value = i + 1 < argc;
+    const std::string_view value = has_value ? argv[i + 1] : "";
+
+    if (argument == "--threads" && parseNumber(value, options.threads)) {
+      options.threads = std::max(options.threads, 1);
+    } else if (argument == "--perft" && parseNumber(value, options.depth)) {
+      options.mode = Mode::PERFT;
+      has_depth = true;
+    } else if (argument == "--depth" && parseNumber(value, options.depth)) {
+      options.mode = Mode::SEARCH;
+      has_depth = true;
+    } else if (argument == "--nodes" && parseNumber(value, options.nodes)) {
+      options.mode = Mode::SEARCH;
+    } else if (argument == "--hash" && parseNumber(value, options.hash_mb)) {
+      options.hash_mb = std::max<std::size_t>(options.hash_mb, 1);
+    } else if (argument == "--format" && (value == "csv" || value == "jsonl")) {
+      options.format = value == "csv" ? Format::CSV : Format::JSONL;
+    } else if (argument == "--output" && has_value) {
+      options.output_path = value;
+    } else if (!argument.starts_with("--") && options.input_path.empty()) {
+      options.input_path = argument;
+      continue;
+    } else {
+      return false;
+    }
+    i++; // skip the value
+  }
+
+  if (options.mode == Mode::SEARCH && !has_depth) {
+    options.depth = TreeSearch::MAX_PLY - 1;
+  }
+  return !options.input_path.empty() && options.depth >= 1 &&
+         (options.mode == Mode::SEARCH ||
+          options.depth < TreeSearch::MAX_PLY);
+}
+
+int32_t Batch::run(const Options &options) {
+  std::ifstream input(options.input_path);
+  if (!input) {
+    std::cerr << "cannot open " << options.input_path << "\n";
+    return 1;
+  }
+
+  std::ofstream output_file;
+  if (!options.output_path.empty()) {
+    output_file.open(options.output_path);
+    if (!output_file) {
+      std::cerr << "cannot open " << options.output_path << "\n";
+      return 1;
+    }
+  }
+  std::ostream &output = options.output_path.empty() ? std::cout : output_file;
+
+  if (options.format == Format::CSV) {
+    output << "index,fen," << csvColumns(options.mode) << ",error\n";
+  }
+
+  Pipeline pipeline{std::max<std::size_t>(options.window, 1)};
+
+  std::vector<std::thread> workers;
+  for (int32_t i = 0; i < options.threads; i++) {
+    workers.emplace_back(worker, std::cref(options), std::ref(pipeline));
+  }
+  std::thread writer_thread(writer, std::ref(output), std::ref(pipeline));
+
+  std::string line;
+  while (std::getline(input, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.find_first_not_of(' ') == std::string::npos || line[0] == '#') {
+      continue;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(pipeline.mutex);
+      pipeline.window_available.wait(lock, [&pipeline] {
+        return pipeline.read_count - pipeline.written_count < pipeline.window;
+      });
+      pipeline.jobs.push_back(Job{pipeline.read_count++, std::move(line)});
+    }
+    pipeline.job_available.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pipeline.mutex);
+    pipeline.input_done = true;
+  }
+  pipeline.job_available.notify_all();
+  pipeline.result_available.notify_all();
+
+  for (auto &worker_thread : workers) {
+    worker_thread.join();
+  }
+  writer_thread.join();
+
+  output.flush();
+  return output ? 0 : 1;
+}
@@ -1,19 +1,26 @@
 #include "board.hpp"
 #include "move.hpp"
 #include "search.hpp"
+#include "stats.hpp"
 #include "undo_move.hpp"
 #include "util.hpp"
+#include "zobrist.hpp"
 
+#include <algorithm>
 #include <bit>
-#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 Board::Board() {
   _last_move_two_squares_push_pawn = 0;
+  _halfmove_clock = 0;
+  _fullmove_number = 1;
 
   _player_turn = false; // white starts first
 
@@ -49,12 +56,58 @@ Board::Board() {
                   << (BOARD_COLS * (BOARD_ROWS - 2));
 
   recomputePiecesPositions();
-  // used for checking castling rights
-  _pieces_not_moved =
-      _pieces[0][2] | _pieces[1][2] | _pieces[0][0] | _pieces[1][0];
+  _castling_rights = 0xF;
+
+  _hash = computeHash();
+  updateCheckers();
+}
+
+Board::Board(std::string_view fen) {
+  if (!setFen(fen)) {
+    throw std::invalid_argument("invalid FEN");
+  }
+}
+
+namespace {
+// returns the next space separated field and drops it from fen
+std::string_view nextFenField(std::string_view &fen) {
+  const std::size_t field_start = std::min(fen.find_first_not_of(' '),
+                                           fen.size());
+  fen.remove_prefix(field_start);
+
+  const std::size_t field_end = std::min(fen.find(' '), fen.size());
+  const std::string_view field = fen.substr(0, field_end);
+  fen.remove_prefix(field_end);
+  return field;
+}
+
+bool parseFenCounter(std::string_view field, uint16_t &counter) {
+  const auto [end, error] =
+      std::from_chars(field.data(), field.data() + field.size(), counter);
+  return error == std::errc{} && end == field.data() + field.size();
+}
+
+int8_t pieceTypeFromLetter(char letter) {
+  switch (letter | 0x20) { // lower case
+  case 'k':
+    return Pieces::KING;
+  case 'q':
+    return Pieces::QUEEN;
+  case 'r':
+    return Pieces::ROOK;
+  case 'b':
+    return Pieces::BISHOP;
+  case 'n':
+    return Pieces::KNIGHT;
+  case 'p':
+    return Pieces::PAWN;
+  default:
+    return Pieces::EMPTY;
+  }
 }
+} // namespace
 
-Board::Board(std::string fen_string) {
+bool Board::setFen(std::string_view fen) {
   for (std::size_t colour{0}; colour < 2; colour++) {
     for (std::size_t piece_type{0}; piece_type < Board::ALL_PIECE_TYPES;
          piece_type++) {
@@ -62,361 +115,546 @@ Board::Board(std::string fen_string) {
     }
   }
 
-  size_t whitespace_loc = fen_string.find(" ");
-
+  // piece placement, from the 8th row down
   int32_t cur_row = 7;
   int32_t piece_col = 0;
 
-  for (const char letter_to_parse : fen_string.substr(0, whitespace_loc)) {
+  for (const char letter_to_parse : nextFenField(fen)) {
     if (letter_to_parse >= '1' && letter_to_parse <= '8') {
       piece_col += letter_to_parse - '0';
     } else if (letter_to_parse == '/') {
+      if (piece_col != BOARD_COLS || cur_row == 0) {
+        return false;
+      }
       piece_col = 0;
       cur_row--;
     } else {
-      bool player_turn = (letter_to_parse >= 'a' && letter_to_parse <= 'z');
-      int32_t piece_type = 0;
-
-      switch (std::tolower(letter_to_parse)) {
-      case 'k':
-        piece_type = 0;
-        break;
-      case 'q':
-        piece_type = 1;
-        break;
-      case 'r':
-        piece_type = 2;
-        break;
-      case 'b':
-        piece_type = 3;
-        break;
-      case 'n':
-        piece_type = 4;
-        break;
-      case 'p':
-        piece_type = 5;
-        break;
+      const int8_t piece_type = pieceTypeFromLetter(letter_to_parse);
+      if (piece_type == Pieces::EMPTY || piece_col >= BOARD_COLS) {
+        return false;
       }
-      // std::cout << cur_row << " " << piece_col << " " << piece_type
-      //           << std::endl;
-      //  std::cout << cur_row << std::endl;
+
+      bool player_turn = (letter_to_parse >= 'a' && letter_to_parse <= 'z');
       _pieces[player_turn][piece_type] |=
           Board::getPositionAsBitboard(cur_row, piece_col);
       piece_col += 1;
     }
+
+    if (piece_col > BOARD_COLS) {
+      return false;
+    }
   }
 
-  // who's turn
-  whitespace_loc = fen_string.find(" ", whitespace_loc + 1);
+  if (cur_row != 0 || piece_col != BOARD_COLS ||
+      std::popcount(_pieces[0][Pieces::KING]) != 1 ||
+      std::popcount(_pieces[1][Pieces::KING]) != 1) {
+    return false;
+  }
 
-  _player_turn = fen_string[whitespace_loc - 1] == 'b';
+  // who's turn
+  const std::string_view turn_field = nextFenField(fen);
+  if (turn_field != "w" && turn_field != "b") {
+    return false;
+  }
+  _player_turn = turn_field == "b";
 
   // handles castling
-  _pieces_not_moved = 0;
+  _castling_rights = 0;
 
-  std::size_t castling_rights_start = whitespace_loc + 1;
-  whitespace_loc = fen_string.find(" ", castling_rights_start);
+  const std::string_view castling_field = nextFenField(fen);
+  if (castling_field.empty()) {
+    return false;
+  }
 
-  for (const char letter_to_parse : fen_string.substr(
-           castling_rights_start, whitespace_loc - castling_rights_start)) {
+  for (const char letter_to_parse : castling_field) {
     switch (letter_to_parse) {
     case 'K':
-      _pieces_not_moved |= Board::getPositionAsBitboard(0, 4);
-      _pieces_not_moved |= Board::getPositionAsBitboard(0, 7);
+      _castling_rights |= 1 << 1;
       break;
     case 'k':
-      _pieces_not_moved |= Board::getPositionAsBitboard(7, 4);
-      _pieces_not_moved |= Board::getPositionAsBitboard(7, 7);
+      _castling_rights |= 1 << 3;
       break;
     case 'Q':
-      _pieces_not_moved |= Board::getPositionAsBitboard(0, 4);
-      _pieces_not_moved |= Board::getPositionAsBitboard(0, 0);
+      _castling_rights |= 1 << 0;
       break;
     case 'q':
-      _pieces_not_moved |= Board::getPositionAsBitboard(7, 4);
-      _pieces_not_moved |= Board::getPositionAsBitboard(7, 0);
+      _castling_rights |= 1 << 2;
       break;
+    case '-':
+      if (castling_field.size() != 1) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+
+  // drop rights whose king or rook is not on its starting square
+  for (int8_t colour = 0; colour < 2; colour++) {
+    const uint64_t king = getPositionAsBitboard(colour ? 7 : 0, 4);
+    for (int8_t castle_type = 0; castle_type < 2; castle_type++) {
+      if (!(_pieces[colour][Pieces::KING] & king) ||
+          !(_pieces[colour][Pieces::ROOK] &
+            MoveExplorer::rook_from[colour][castle_type])) {
+        _castling_rights &= ~(1 << (colour * 2 + castle_type));
+      }
     }
   }
 
-  std::size_t enpassant_attack_square_start = whitespace_loc + 1;
-  whitespace_loc = fen_string.find(" ", enpassant_attack_square_start);
+  // the en passant square is behind the pawn that was just pushed
+  const std::string_view en_passant_field = nextFenField(fen);
+  _last_move_two_squares_push_pawn = chessSquareAsPosition(en_passant_field);
 
-  _last_move_two_squares_push_pawn = chessSquareAsPosition(
-      fen_string.substr(enpassant_attack_square_start,
-                        whitespace_loc - enpassant_attack_square_start));
+  const uint64_t en_passant_row = uint64_t{0xFF}
+                                  << (BOARD_COLS * (_player_turn ? 2 : 5));
+  if (en_passant_field != "-" &&
+      (_last_move_two_squares_push_pawn & en_passant_row) == 0) {
+    return false;
+  }
+
+  // the move counters are optional, EPD lines leave them out
+  _halfmove_clock = 0;
+  _fullmove_number = 1;
+
+  const std::string_view halfmove_field = nextFenField(fen);
+  if (!halfmove_field.empty() &&
+      !parseFenCounter(halfmove_field, _halfmove_clock)) {
+    return false;
+  }
 
-  // TODO halfmove counter
+  const std::string_view fullmove_field = nextFenField(fen);
+  if (!fullmove_field.empty() &&
+      !parseFenCounter(fullmove_field, _fullmove_number)) {
+    return false;
+  }
+  _fullmove_number = std::max<uint16_t>(_fullmove_number, 1);
+
+  if (!nextFenField(fen).empty()) {
+    return false;
+  }
 
-  // TODO fullmove counter
   recomputePiecesPositions();
+
+  _hash = computeHash();
+  updateCheckers();
+  return true;
 }
 
-void Board::makeMove(const std::string &move_to_make) {
+std::size_t Board::toFen(char (&out)[MAX_FEN_LENGTH]) const {
+  static constexpr char piece_letters[] = "KkQqRrBbNnPp";
+
+  char *cur = out;
+  for (int32_t row = BOARD_ROWS - 1; row >= 0; row--) {
+    int32_t empty_cells = 0;
+    for (int32_t col = 0; col < BOARD_COLS; col++) {
+      const SquareType square_type =
+          getPieceOnSquare(getPositionAsBitboard(row, col));
+      if (square_type == SquareType::EMPTY) {
+        empty_cells++;
+        continue;
+      }
 
-  std::vector<Move> all_moves;
-  all_moves.resize(256);
-  MoveExplorer::searchAllMoves(*this, _player_turn, all_moves);
+      if (empty_cells) {
+        *cur++ = char('0' + empty_cells);
+        empty_cells = 0;
+      }
+      *cur++ = piece_letters[int8_t(square_type)];
+    }
 
-  UndoMove undo_move;
-  for (const auto &possible_move : all_moves) {
-    if (possible_move.formatted() == move_to_make) {
-      makeMove(possible_move, undo_move);
+    if (empty_cells) {
+      *cur++ = char('0' + empty_cells);
+    }
+    if (row) {
+      *cur++ = '/';
     }
   }
-}
 
-uint64_t Board::chessSquareAsPosition(std::string chess_square) {
-  if (chess_square == "-") {
-    return 0;
+  *cur++ = ' ';
+  *cur++ = _player_turn ? 'b' : 'w';
+  *cur++ = ' ';
+
+  const char *castling_start = cur;
+  if (checkCastlingRights(0, 1)) {
+    *cur++ = 'K';
+  }
+  if (checkCastlingRights(0, 0)) {
+    *cur++ = 'Q';
+  }
+  if (checkCastlingRights(1, 1)) {
+    *cur++ = 'k';
+  }
+  if (checkCastlingRights(1, 0)) {
+    *cur++ = 'q';
+  }
+  if (cur == castling_start) {
+    *cur++ = '-';
   }
 
-  int8_t col = chess_square[0] - 'a';
-  int8_t row = chess_square[1] - '1';
+  *cur++ = ' ';
+  cur = positionAsChessSquare(_last_move_two_squares_push_pawn, cur);
 
-  return getPositionAsBitboard(row, col);
-}
+  // each counter needs its separator and at least one digit, the last
+  // byte is kept for the terminator
+  char *const end = out + MAX_FEN_LENGTH - 1;
+  for (const uint16_t counter : {_halfmove_clock, _fullmove_number}) {
+    if (end - cur < 2) {
+      break;
+    }
+    *cur = ' ';
+    const auto [ptr, ec] = std::to_chars(cur + 1, end, counter);
+    if (ec != std::errc{}) {
+      break;
+    }
+    cur = ptr;
+  }
 
-bool Board::checkCastlingRights(bool turn, bool castle_type) const {
-  int8_t row_to_use = turn ? 7 : 0;
-  int8_t col_to_use = castle_type ? 7 : 0;
+  *cur = '\0';
+  return cur - out;
+}
 
-  uint64_t wanted_positions =
-      Board::getPositionAsBitboard(row_to_use, 4) |
-      Board::getPositionAsBitboard(row_to_use, col_to_use);
+bool Board::makeMove(std::string_view move_to_make) {
+  Move move;
+  if (!parseMove(move_to_make, move)) {
+    return false;
+  }
 
-  return (wanted_positions & _pieces_not_moved) == wanted_positions;
+  UndoMove undo_move;
+  makeMove(move, undo_move);
+  return true;
 }
 
-bool Board::isEnPassant(uint64_t pos, bool turn) const {
-  return _last_move_two_squares_push_pawn == pos;
-}
+bool Board::parseMove(std::string_view uci_move, Move &move) {
+  if (uci_move.size() != 4 && uci_move.size() != 5) {
+    return false;
+  }
 
-void Board::unmakeMove(const UndoMove &undo_move) {
-  _player_turn ^= 1;
+  const uint64_t pos_from = chessSquareAsPosition(uci_move.substr(0, 2));
+  const uint64_t pos_to = chessSquareAsPosition(uci_move.substr(2, 2));
+  if (pos_from == 0 || pos_to == 0) {
+    return false;
+  }
 
-  _pieces_not_moved = undo_move.pieces_not_moved;
-  _last_move_two_squares_push_pawn = undo_move.prev_enpassant_pos;
+  // PAWN_MOVE stands for "no promotion" here
+  MoveType promotion = MoveType::PAWN_MOVE;
+  if (uci_move.size() == 5) {
+    switch (uci_move[4]) {
+    case 'q':
+      promotion = MoveType::PAWN_PROMOTE_QUEEN;
+      break;
+    case 'r':
+      promotion = MoveType::PAWN_PROMOTE_ROOK;
+      break;
+    case 'b':
+      promotion = MoveType::PAWN_PROMOTE_BISHOP;
+      break;
+    case 'n':
+      promotion = MoveType::PAWN_PROMOTE_KNIGHT;
+      break;
+    default:
+      return false;
+    }
+  }
 
-  _pieces[_player_turn][undo_move.piece_type] ^= undo_move.from_pos;
+  const SquareType square_type = getPieceOnSquare(pos_from);
+  if (square_type == SquareType::EMPTY ||
+      (int8_t(square_type) & 1) != _player_turn) {
+    return false;
+  }
+
+  // only the moving piece's moves are generated,
+  // the buffer is kept between calls so parsing does not allocate
+  static thread_local std::vector<Move> piece_moves;
+  piece_moves.clear();
+  piece_moves.reserve(256);
 
-  switch (undo_move.move_type) {
-  case MoveType::PAWN_PROMOTE_QUEEN: {
-    _pieces[_player_turn][Pieces::QUEEN] ^= undo_move.to_pos;
+  switch (Pieces(int8_t(square_type) >> 1)) {
+  case Pieces::KING:
+    MoveExplorer::searchKingMoves(*this, _player_turn, piece_moves);
     break;
-  }
-  case MoveType::PAWN_PROMOTE_ROOK: {
-    _pieces[_player_turn][Pieces::ROOK] ^= undo_move.to_pos;
+  case Pieces::QUEEN:
+    MoveExplorer::searchQueenMoves(*this, _player_turn, piece_moves);
     break;
-  }
-  case MoveType::PAWN_PROMOTE_BISHOP: {
-    _pieces[_player_turn][Pieces::BISHOP] ^= undo_move.to_pos;
+  case Pieces::ROOK:
+    MoveExplorer::searchRookMoves(*this, _player_turn, piece_moves);
     break;
-  }
-  case MoveType::PAWN_PROMOTE_KNIGHT: {
-    _pieces[_player_turn][Pieces::KNIGHT] ^= undo_move.to_pos;
+  case Pieces::BISHOP:
+    MoveExplorer::searchBishopMoves(*this, _player_turn, piece_moves);
     break;
-  }
-  case MoveType::PAWN_MOVE_TWO_SQUARES: {
-    _pieces[_player_turn][Pieces::PAWN] ^= undo_move.to_pos;
+  case Pieces::KNIGHT:
+    MoveExplorer::searchKnightMoves(*this, _player_turn, piece_moves);
     break;
-  }
-  case MoveType::SHORT_CASTLE_KING_MOVE: {
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_from[_player_turn][1];
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_to[_player_turn][1];
-
-    _pieces[_player_turn][Pieces::KING] ^= undo_move.to_pos;
+  default:
+    MoveExplorer::searchPawnMoves(*this, _player_turn, piece_moves);
     break;
   }
-  case MoveType::LONG_CASTLE_KING_MOVE: {
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_from[_player_turn][0];
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_to[_player_turn][0];
 
-    _pieces[_player_turn][Pieces::KING] ^= undo_move.to_pos;
-    break;
-  }
-  default: {
-    _pieces[_player_turn][undo_move.piece_type] ^= undo_move.to_pos;
+  for (const Move &possible_move : piece_moves) {
+    if (possible_move.pos_from != pos_from || possible_move.pos_to != pos_to) {
+      continue;
+    }
+
+    const bool is_promotion =
+        possible_move.move_type >= MoveType::PAWN_PROMOTE_QUEEN;
+    if (is_promotion ? possible_move.move_type != promotion
+                     : promotion != MoveType::PAWN_MOVE) {
+      continue;
+    }
+
+    move = possible_move;
+    return true;
   }
+  return false;
+}
+
+uint64_t Board::chessSquareAsPosition(std::string_view chess_square) {
+  if (chess_square.size() != 2 || chess_square[0] < 'a' ||
+      chess_square[0] > 'h' || chess_square[1] < '1' ||
+      chess_square[1] > '8') {
+    return 0;
   }
 
-  if (undo_move.taken_piece != -1) {
-    if (undo_move.move_type == MoveType::REGULAR_PAWN_CAPTURE &&
-        undo_move.to_pos == undo_move.prev_enpassant_pos) {
-      _pieces[_player_turn ^ 1][undo_move.taken_piece] ^=
-          Board::shiftPosition(undo_move.to_pos, _player_turn ? +8 : -8, 0);
-    } else {
-      _pieces[_player_turn ^ 1][undo_move.taken_piece] ^= undo_move.to_pos;
+  int8_t col = chess_square[0] - 'a';
+  int8_t row = chess_square[1] - '1';
+
+  return getPositionAsBitboard(row, col);
+}
+
+bool Board::isEnPassant(uint64_t pos, bool turn) const {
+  return _last_move_two_squares_push_pawn == pos;
+}
+
+void Board::recomputePiecesPositions() {
+  std::fill(std::begin(_squares), std::end(_squares), SquareType::EMPTY);
+  for (int8_t turn = 0; turn < 2; turn++) {
+    _occupancy[turn] = 0;
+    for (int8_t piece = 0; piece < ALL_PIECE_TYPES; piece++) {
+      _occupancy[turn] |= _pieces[turn][piece];
+      for (uint64_t bits = _pieces[turn][piece]; bits; bits &= bits - 1) {
+        _squares[std::countr_zero(bits)] = SquareType((piece << 1) | turn);
+      }
     }
   }
 }
 
-void Board::makeMove(const Move &move_to_make, UndoMove &undo_move) {
-  undo_move.pieces_not_moved = _pieces_not_moved;
-  _pieces_not_moved &= ~(move_to_make.pos_from |
-                         move_to_make.pos_to); // mark the current cell as moved
+namespace {
+inline bool isPromotion(const MoveType move_type) {
+  return move_type >= MoveType::PAWN_PROMOTE_QUEEN;
+}
 
-  undo_move.from_pos = move_to_make.pos_from;
-  undo_move.to_pos = move_to_make.pos_to;
-  undo_move.taken_piece = -1;
+// the piece a move leaves on its destination square
+inline int8_t placedPiece(const MoveType move_type, const int8_t piece_type) {
+  return isPromotion(move_type)
+             ? int8_t(int32_t(move_type) -
+                      int32_t(MoveType::PAWN_PROMOTE_QUEEN) + Pieces::QUEEN)
+             : piece_type;
+}
 
-  undo_move.piece_type = move_to_make.piece_type;
-  _pieces[_player_turn][move_to_make.piece_type] ^= move_to_make.pos_from;
+inline bool isCastle(const MoveType move_type) {
+  return move_type == MoveType::SHORT_CASTLE_KING_MOVE ||
+         move_type == MoveType::LONG_CASTLE_KING_MOVE;
+}
+}; // namespace
 
-  undo_move.prev_enpassant_pos = _last_move_two_squares_push_pawn;
-  _last_move_two_squares_push_pawn = 0;
+void Board::unmakeMove(const UndoMove &undo_move) {
+  Stats::add(Stats::UNMAKE_MOVE);
+  _player_turn ^= 1;
+  const bool turn = _player_turn;
 
-  undo_move.move_type = move_to_make.move_type;
-  switch (move_to_make.move_type) {
-  case MoveType::PAWN_PROMOTE_QUEEN:
-    _pieces[_player_turn][Pieces::QUEEN] ^= move_to_make.pos_to;
-    break;
-  case MoveType::PAWN_PROMOTE_ROOK:
-    _pieces[_player_turn][Pieces::ROOK] ^= move_to_make.pos_to;
-    ;
-    break;
-  case MoveType::PAWN_PROMOTE_BISHOP:
-    _pieces[_player_turn][Pieces::BISHOP] ^= move_to_make.pos_to;
-    ;
-    break;
-  case MoveType::PAWN_PROMOTE_KNIGHT:
-    _pieces[_player_turn][Pieces::KNIGHT] ^= move_to_make.pos_to;
-    break;
-  case MoveType::PAWN_MOVE_TWO_SQUARES: {
-    if (_player_turn) {
-      _last_move_two_squares_push_pawn = (move_to_make.pos_to << 8);
-    } else {
-      _last_move_two_squares_push_pawn = (move_to_make.pos_to >> 8);
-    }
+  _hash = undo_move.hash;
+  _checkers = undo_move.checkers;
+  _halfmove_clock = undo_move.halfmove_clock;
+  _fullmove_number -= turn;
+  _castling_rights = undo_move.castling_rights;
+  _last_move_two_squares_push_pawn = undo_move.prev_enpassant_pos;
 
-    _pieces[_player_turn][move_to_make.piece_type] ^= move_to_make.pos_to;
-    break;
+  const int8_t from_sq = std::countr_zero(undo_move.from_pos);
+  const int8_t to_sq = std::countr_zero(undo_move.to_pos);
+
+  _pieces[turn][placedPiece(undo_move.move_type, undo_move.piece_type)] ^=
+      undo_move.to_pos;
+  _squares[to_sq] = SquareType::EMPTY;
+  _occupancy[turn] ^= undo_move.from_pos | undo_move.to_pos;
+  _pieces[turn][undo_move.piece_type] ^= undo_move.from_pos;
+  _squares[from_sq] = SquareType((undo_move.piece_type << 1) | turn);
+
+  if (isCastle(undo_move.move_type)) {
+    const bool castle_type =
+        undo_move.move_type == MoveType::SHORT_CASTLE_KING_MOVE;
+    const uint64_t rook_from = MoveExplorer::rook_from[turn][castle_type];
+    const uint64_t rook_to = MoveExplorer::rook_to[turn][castle_type];
+    _pieces[turn][Pieces::ROOK] ^= rook_from | rook_to;
+    _occupancy[turn] ^= rook_from | rook_to;
+    _squares[std::countr_zero(rook_to)] = SquareType::EMPTY;
+    _squares[std::countr_zero(rook_from)] =
+        SquareType((Pieces::ROOK << 1) | turn);
+  } else if (undo_move.taken_piece != -1) {
+    _pieces[turn ^ 1][undo_move.taken_piece] ^=
+        uint64_t{1} << undo_move.taken_square;
+    _occupancy[turn ^ 1] ^= uint64_t{1} << undo_move.taken_square;
+    _squares[undo_move.taken_square] =
+        SquareType((undo_move.taken_piece << 1) | (turn ^ 1));
   }
-  case MoveType::SHORT_CASTLE_KING_MOVE: {
-    _pieces[_player_turn][move_to_make.piece_type] ^= move_to_make.pos_to;
+}
 
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_from[_player_turn][1];
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_to[_player_turn][1];
+inline void Board::applyMove(const Move &move_to_make, UndoMove &undo_move) {
+  Stats::add(Stats::MAKE_MOVE);
+  const auto &keys = Zobrist::keys;
+  const bool turn = _player_turn;
+  const int8_t piece_type = move_to_make.piece_type;
+  const MoveType move_type = move_to_make.move_type;
+  const int8_t from_sq = std::countr_zero(move_to_make.pos_from);
+  const int8_t to_sq = std::countr_zero(move_to_make.pos_to);
+
+  undo_move.hash = _hash;
+  undo_move.checkers = _checkers;
+  undo_move.halfmove_clock = _halfmove_clock;
+  undo_move.castling_rights = _castling_rights;
+  undo_move.prev_enpassant_pos = _last_move_two_squares_push_pawn;
+  undo_move.from_pos = move_to_make.pos_from;
+  undo_move.to_pos = move_to_make.pos_to;
+  undo_move.piece_type = piece_type;
+  undo_move.move_type = move_type;
+
+  _hash ^= keys.black_to_move;
+  _fullmove_number += turn;
 
-    _player_turn ^= 1; // change player's turn
-    return;
+  if (_last_move_two_squares_push_pawn) {
+    _hash ^=
+        keys.en_passant[std::countr_zero(_last_move_two_squares_push_pawn) %
+                        BOARD_COLS];
+    _last_move_two_squares_push_pawn = 0;
   }
-  case MoveType::LONG_CASTLE_KING_MOVE: {
-    _pieces[_player_turn][move_to_make.piece_type] ^= move_to_make.pos_to;
 
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_from[_player_turn][0];
-    _pieces[_player_turn][Pieces::ROOK] ^=
-        MoveExplorer::rook_to[_player_turn][0];
+  // a king or rook leaving or being taken on its square ends the right
+  _castling_rights &= MoveExplorer::castling_rights_masks[from_sq] &
+                      MoveExplorer::castling_rights_masks[to_sq];
+  if (_castling_rights != undo_move.castling_rights) {
+    _hash ^= keys.castling[undo_move.castling_rights];
+    _hash ^= keys.castling[_castling_rights];
+  }
 
-    _player_turn ^= 1; // change player's turn
-    return;
+  /*
+   * The captured piece is read from the square lookup. En passant is the
+   * only capture that does not take on the destination square.
+   */
+  int8_t taken_sq = to_sq;
+  if (piece_type == Pieces::PAWN &&
+      move_to_make.pos_to == undo_move.prev_enpassant_pos) {
+    taken_sq += turn ? +8 : -8;
   }
-  default:
-    _pieces[_player_turn][move_to_make.piece_type] ^= move_to_make.pos_to;
-    break;
+  const SquareType taken = _squares[taken_sq];
+  undo_move.taken_square = taken_sq;
+  if (taken == SquareType::EMPTY) {
+    undo_move.taken_piece = -1;
+    _halfmove_clock =
+        piece_type == Pieces::PAWN ? 0 : _halfmove_clock + 1;
+  } else {
+    const int8_t taken_piece = int8_t(taken) >> 1;
+    undo_move.taken_piece = taken_piece;
+    _halfmove_clock = 0;
+
+    _pieces[turn ^ 1][taken_piece] ^= uint64_t{1} << taken_sq;
+    _occupancy[turn ^ 1] ^= uint64_t{1} << taken_sq;
+    _squares[taken_sq] = SquareType::EMPTY;
+    _hash ^= keys.pieces[turn ^ 1][taken_piece][taken_sq];
   }
 
-  for (std::size_t i{0}; i < ALL_PIECE_TYPES; i++) {
-    /* clear the to_pos position
-     * where the pawn
-     * that moved two squares actually is
-     */
-    if (undo_move.prev_enpassant_pos == move_to_make.pos_to &&
-        move_to_make.move_type == MoveType::REGULAR_PAWN_CAPTURE) {
-      if (_player_turn) {
-        _pieces[_player_turn ^ 1][i] &= ~(move_to_make.pos_to << 8);
-      } else {
-        _pieces[_player_turn ^ 1][i] &= ~(move_to_make.pos_to >> 8);
-      }
-      undo_move.taken_piece = Pieces::PAWN;
-    }
-
-    if (_pieces[_player_turn ^ 1][i] & move_to_make.pos_to) {
-      undo_move.taken_piece = i;
-    }
-    _pieces[_player_turn ^ 1][i] &=
-        ~move_to_make.pos_to; // clear the to_pos position
+  _occupancy[turn] ^= move_to_make.pos_from | move_to_make.pos_to;
+  _pieces[turn][piece_type] ^= move_to_make.pos_from;
+  _squares[from_sq] = SquareType::EMPTY;
+  _hash ^= keys.pieces[turn][piece_type][from_sq];
+
+  const int8_t placed = placedPiece(move_type, piece_type);
+  _pieces[turn][placed] ^= move_to_make.pos_to;
+  _squares[to_sq] = SquareType((placed << 1) | turn);
+  _hash ^= keys.pieces[turn][placed][to_sq];
+
+  if (move_type == MoveType::PAWN_MOVE_TWO_SQUARES) {
+    _last_move_two_squares_push_pawn =
+        turn ? move_to_make.pos_to << 8 : move_to_make.pos_to >> 8;
+    _hash ^= keys.en_passant[to_sq % BOARD_COLS];
+  } else if (isCastle(move_type)) {
+    const bool castle_type = move_type == MoveType::SHORT_CASTLE_KING_MOVE;
+    const uint64_t rook_from = MoveExplorer::rook_from[turn][castle_type];
+    const uint64_t rook_to = MoveExplorer::rook_to[turn][castle_type];
+    const int8_t rook_from_sq = std::countr_zero(rook_from);
+    const int8_t rook_to_sq = std::countr_zero(rook_to);
+
+    _pieces[turn][Pieces::ROOK] ^= rook_from | rook_to;
+    _occupancy[turn] ^= rook_from | rook_to;
+    _squares[rook_from_sq] = SquareType::EMPTY;
+    _squares[rook_to_sq] = SquareType((Pieces::ROOK << 1) | turn);
+    _hash ^= keys.pieces[turn][Pieces::ROOK][rook_from_sq];
+    _hash ^= keys.pieces[turn][Pieces::ROOK][rook_to_sq];
   }
+
   _player_turn ^= 1; // change player's turn
+  updateCheckers();
 }
 
-bool Board::isUnderCheck(const uint64_t pos_to_check, bool turn) const {
-  const uint64_t king_pos = pos_to_check;
-
-  // check for line checks
-  for (std::size_t i{0}; i < MoveExplorer::combined_shifts.size(); i++) {
-    uint64_t cell_under_investigation = king_pos;
-    int8_t shift_dir = MoveExplorer::combined_shifts[i];
-    uint64_t mask = MoveExplorer::combined_shifts_masks[i];
-
-    cell_under_investigation =
-        shiftPosition(cell_under_investigation, shift_dir, mask);
-
-    int8_t steps = 1;
-    while (cell_under_investigation) {
-      if (isCellNotEmpty(cell_under_investigation, turn)) {
-        break;
-      } else if (isCellNotEmpty(cell_under_investigation, turn ^ 1)) {
-        // check if it's a bishop
-        uint64_t all_pieces = 0;
-        if (i < 4) {
-          all_pieces |= _pieces[turn ^ 1][Pieces::BISHOP];
-        } else {
-          all_pieces |= _pieces[turn ^ 1][Pieces::ROOK];
-        }
-        all_pieces |= _pieces[turn ^ 1][QUEEN];
-        if (steps == 1) {
-          all_pieces |= _pieces[turn ^ 1][KING];
-        }
+void Board::makeMove(const Move &move_to_make, UndoMove &undo_move) {
+  applyMove(move_to_make, undo_move);
+}
 
-        if (all_pieces & cell_under_investigation) {
-          return true;
-        } else {
-          break;
-        }
-      }
-      steps++;
-      cell_under_investigation =
-          shiftPosition(cell_under_investigation, shift_dir, mask);
-    }
-  }
+void Board::makeMove(const Move &move_to_make) {
+  // the compiler drops the stores into the unused record
+  UndoMove undo_move;
+  applyMove(move_to_make, undo_move);
+}
 
-  // check for pawn checks
-  uint64_t pawn_positions =
-      Board::shiftPosition(
-          king_pos, turn ? -9 : +7,
-          MoveExplorer::FILE_A |
-              (turn ? MoveExplorer::ROW_ONE : MoveExplorer::ROW_SEVEN)) |
-      Board::shiftPosition(
-          king_pos, turn ? -7 : +9,
-          MoveExplorer::FILE_H |
-              (turn ? MoveExplorer::ROW_ONE : MoveExplorer::ROW_SEVEN));
-  if (_pieces[turn ^ 1][Pieces::PAWN] & pawn_positions) {
-    return true;
-  }
 
-  int64_t knight_positions = 0;
-  for (std::size_t i{0}; i < MoveExplorer::knight_move_shifts.size(); i++) {
-    const uint64_t to_check_for_knight_pos =
-        Board::shiftPosition(king_pos, MoveExplorer::knight_move_shifts[i],
-                             MoveExplorer::knight_move_shifts_masks[i]);
+uint64_t Board::attackersTo(const int8_t square, const bool turn,
+                            const uint64_t occupancy) const {
+  const uint64_t(&enemy)[ALL_PIECE_TYPES] = _pieces[turn ^ 1];
+
+  // leapers attack back along the same pattern they move with
+  uint64_t attackers =
+      (MoveExplorer::pawn_attacks[turn][square] & enemy[Pieces::PAWN]) |
+      (MoveExplorer::knight_attacks[square] & enemy[Pieces::KNIGHT]) |
+      (MoveExplorer::king_attacks[square] & enemy[Pieces::KING]);
 
-    knight_positions |= to_check_for_knight_pos;
+  // sliders are only traced when one of them is on a line with the square
+  const uint64_t lines = enemy[Pieces::ROOK] | enemy[Pieces::QUEEN];
+  if (MoveExplorer::line_rays[square] & lines) {
+    attackers |= MoveExplorer::rookAttacks(square, occupancy) & lines;
   }
-  if (_pieces[turn ^ 1][Pieces::KNIGHT] & knight_positions) {
-    return true;
+  const uint64_t diagonals = enemy[Pieces::BISHOP] | enemy[Pieces::QUEEN];
+  if (MoveExplorer::diag_rays[square] & diagonals) {
+    attackers |= MoveExplorer::bishopAttacks(square, occupancy) & diagonals;
   }
 
+  return attackers;
+}
+
+bool Board::isAnyAttacked(uint64_t squares, const bool turn) const {
+  const uint64_t occupancy = getAllPieces(0) | getAllPieces(1);
+  while (squares) {
+    if (attackersTo(std::countr_zero(squares), turn, occupancy)) {
+      return true;
+    }
+    squares &= squares - 1;
+  }
   return false;
 }
 
+bool Board::isUnderCheck(const uint64_t pos_to_check, bool turn) const {
+  Stats::add(Stats::IS_UNDER_CHECK);
+  if (pos_to_check == 0) {
+    return false;
+  }
+
+  return attackersTo(std::countr_zero(pos_to_check), turn,
+                     getAllPieces(0) | getAllPieces(1)) != 0;
+}
+
+void Board::updateCheckers() {
+  const uint64_t king = _pieces[_player_turn][Pieces::KING];
+  _checkers = king ? attackersTo(std::countr_zero(king), _player_turn,
+                                 getAllPieces(0) | getAllPieces(1))
+                   : 0;
+}
+
 void Board::displayBoard() const {
   std::cout << (_player_turn ? "Black to turn" : "White to turn") << "\n";
 
@@ -425,7 +663,10 @@ void Board::displayBoard() const {
   std::cout << checkCastlingRights(1, 1) << "\n";
   std::cout << checkCastlingRights(1, 0) << "\n";
 
-  std::cout << positionAsChessSquare(_last_move_two_squares_push_pawn) << "\n";
+  char en_passant_square[3];
+  *positionAsChessSquare(_last_move_two_squares_push_pawn, en_passant_square) =
+      '\0';
+  std::cout << en_passant_square << "\n";
 
   const std::array<char, 7> piece_type_to_char = {'k', 'q', 'r', 'b',
                                                   'n', 'p', ' '};
@@ -469,32 +710,70 @@ void Board::displayBoard() const {
   }
 }
 
-std::string Board::positionAsChessSquare(uint64_t pos) {
+char *Board::positionAsChessSquare(uint64_t pos, char *out) {
   if (pos == 0) {
-    return "-";
+    *out++ = '-';
+    return out;
   }
 
-  std::size_t arr_pos = std::__countr_zero(pos);
+  std::size_t arr_pos = std::countr_zero(pos);
 
-  int8_t row = arr_pos / BOARD_COLS;
-  int8_t cols = arr_pos % BOARD_COLS;
-
-  return std::string{char(cols + 'a'), char(row + '1')};
+  *out++ = char(arr_pos % BOARD_COLS + 'a');
+  *out++ = char(arr_pos / BOARD_COLS + '1');
+  return out;
 }
 
 uint64_t Board::getPiece(int8_t piece_type, bool colour) const {
   return _pieces[colour][piece_type];
 }
 
-SquareType Board::getPieceOnSquare(int64_t sq) const {
+bool Board::getPlayerTurn() const { return _player_turn; }
+
+uint64_t Board::getLastMoveTwoSquaresPushPawn() const {
+  return _last_move_two_squares_push_pawn;
+}
+
+uint64_t Board::getHash() const { return _hash; }
+
+uint16_t Board::getHalfmoveClock() const { return _halfmove_clock; }
+
+uint16_t Board::getFullmoveNumber() const { return _fullmove_number; }
+
+bool Board::isRepetition(std::span<const uint64_t> previous_keys) const {
+  // nothing before the last irreversible move can repeat, and a position
+  // needs at least two moves per side to come back
+  const std::size_t size = previous_keys.size();
+  const std::size_t reach = std::min<std::size_t>(_halfmove_clock, size);
+  for (std::size_t back = 4; back <= reach; back += 2) {
+    if (previous_keys[size - back] == _hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t Board::computeHash() const {
+  const auto &keys = Zobrist::keys;
+  uint64_t hash = 0;
+
   for (int32_t turn = 0; turn < 2; turn++) {
     for (int32_t i = 0; i < ALL_PIECE_TYPES; i++) {
-      if (_pieces[turn][i] & sq) {
-        return SquareType((i << 1) | turn);
+      uint64_t piece_positions = _pieces[turn][i];
+      while (piece_positions) {
+        hash ^= keys.pieces[turn][i][std::countr_zero(piece_positions)];
+        piece_positions &= piece_positions - 1;
       }
     }
   }
-  return SquareType::EMPTY;
-}
 
-bool Board::getPlayerTurn() const { return _player_turn; }
+  hash ^= keys.castling[getCastlingRights()];
+  if (_last_move_two_squares_push_pawn) {
+    hash ^= keys.en_passant[std::countr_zero(_last_move_two_squares_push_pawn) %
+                            BOARD_COLS];
+  }
+  if (_player_turn) {
+    hash ^= keys.black_to_move;
+  }
+
+  return hash;
+}
@@ -0,0 +1,152 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+Engine::Engine(int32_t workers) {
+  if (workers <= 0) {
+    workers = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  for (int32_t i = 0; i < workers; i++) {
+    _workers.emplace_back(&Engine::workerLoop, this);
+  }
+}
+
+Engine::~Engine() {
+  std::vector<std::shared_ptr<Session>> sessions;
+  {
+    std::lock_guard lock(_mutex);
+    _shutting_down = true;
+    for (const std::weak_ptr<Session> &session : _sessions) {
+      if (std::shared_ptr<Session> alive = session.lock()) {
+        sessions.push_back(std::move(alive));
+      }
+    }
+  }
+
+  // queued analyses still run, but return as soon as they start
+  for (const std::shared_ptr<Session> &session : sessions) {
+    session->cancel();
+  }
+  _job_available.notify_all();
+
+  for (std::thread &worker : _workers) {
+    worker.join();
+  }
+}
+
+std::shared_ptr<Session> Engine::createSession(std::size_t hash_mb) {
+  std::shared_ptr<Session> session(new Session(*this, hash_mb));
+
+  std::lock_guard lock(_mutex);
+  std::erase_if(_sessions, [](const std::weak_ptr<Session> &entry) {
+    return entry.expired();
+  });
+  _sessions.push_back(session);
+  return session;
+}
+
+std::shared_ptr<Session> Engine::createSession() {
+  return createSession(Session::DEFAULT_HASH_MB);
+}
+
+int32_t Engine::workerCount() const { return int32_t(_workers.size()); }
+
+void Engine::submit(std::function<void()> job) {
+  {
+    std::lock_guard lock(_mutex);
+    _jobs.push_back(std::move(job));
+  }
+  _job_available.notify_one();
+}
+
+void Engine::workerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock lock(_mutex);
+      _job_available.wait(
+          lock, [this] { return !_jobs.empty() || _shutting_down; });
+      // the queue is drained before shutting down so no future is dropped
+      if (_jobs.empty()) {
+        return;
+      }
+      job = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+    job();
+  }
+}
+
+Session::Session(Engine &engine, std::size_t hash_mb)
+    : _engine(engine), _tt(hash_mb) {}
+
+bool Session::setPosition(std::string_view fen,
+                          const std::vector<std::string> &moves) {
+  Board board;
+  if (!board.setFen(fen)) {
+    return false;
+  }
+  std::vector<uint64_t> key_history;
+  key_history.reserve(moves.size());
+  for (const std::string &move : moves) {
+    const uint64_t key = board.getHash();
+    if (!board.makeMove(move)) {
+      return false;
+    }
+    key_history.push_back(key);
+  }
+
+  std::lock_guard lock(_mutex);
+  _board = board;
+  _key_history = std::move(key_history);
+  return true;
+}
+
+std::string Session::getFen() const {
+  char fen[Board::MAX_FEN_LENGTH];
+  std::lock_guard lock(_mutex);
+  return std::string(fen, _board.toFen(fen));
+}
+
+std::future<TreeSearch::SearchResult>
+Session::analyze(const TreeSearch::SearchLimits &limits,
+                 TreeSearch::ReportCallback report) {
+  auto stop = std::make_shared<std::atomic<bool>>(false);
+  auto promise = std::make_shared<std::promise<TreeSearch::SearchResult>>();
+  std::future<TreeSearch::SearchResult> result = promise->get_future();
+
+  Board board;
+  std::vector<uint64_t> key_history;
+  {
+    std::lock_guard lock(_mutex);
+    board = _board;
+    key_history = _key_history;
+    _stop_flags.push_back(stop);
+  }
+
+  _engine.submit([session = shared_from_this(), board,
+                  key_history = std::move(key_history), limits,
+                  report = std::move(report), stop, promise] {
+    try {
+      promise->set_value(TreeSearch::findBestMove(board, limits, session->_tt,
+                                                  *stop, 1, report, nullptr,
+                                                  key_history));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+
+    std::lock_guard lock(session->_mutex);
+    std::erase(session->_stop_flags, stop);
+  });
+  return result;
+}
+
+void Session::cancel() {
+  std::lock_guard lock(_mutex);
+  for (const std::shared_ptr<std::atomic<bool>> &stop : _stop_flags) {
+    stop->store(true, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,113 @@
+#include "large-buffer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+// below this a thread costs more to start than it saves
+constexpr std::size_t MIN_ZERO_CHUNK = std::size_t{32} << 20;
+
+void *mapAligned(std::size_t size) {
+  // mmap only promises page alignment, so map one huge page more
+  // than needed and give back the unaligned head and the tail
+  const std::size_t mapped_size = size + LargeBuffer::HUGE_PAGE_SIZE;
+  void *mapping = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+  const uintptr_t aligned = (start + LargeBuffer::HUGE_PAGE_SIZE - 1) &
+                            ~(LargeBuffer::HUGE_PAGE_SIZE - 1);
+  const std::size_t head = aligned - start;
+  if (head) {
+    ::munmap(mapping, head);
+  }
+  const std::size_t tail = mapped_size - head - size;
+  if (tail) {
+    ::munmap(reinterpret_cast<void *>(aligned + size), tail);
+  }
+
+#ifdef MADV_HUGEPAGE
+  // only a hint, without transparent huge pages this is a no-op
+  ::madvise(reinterpret_cast<void *>(aligned), size, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<void *>(aligned);
+}
+} // namespace
+
+LargeBuffer::LargeBuffer(std::size_t bytes) {
+  const std::size_t size = std::max<std::size_t>(
+      (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1), HUGE_PAGE_SIZE);
+
+  _data = mapAligned(size);
+  _mapped = _data != nullptr;
+  if (!_data) {
+    _data = std::aligned_alloc(HUGE_PAGE_SIZE, size);
+  }
+  if (!_data) {
+    throw std::bad_alloc();
+  }
+  _size = size;
+}
+
+LargeBuffer::~LargeBuffer() { release(); }
+
+LargeBuffer::LargeBuffer(LargeBuffer &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _mapped(std::exchange(other._mapped, false)) {}
+
+LargeBuffer &LargeBuffer::operator=(LargeBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _mapped = std::exchange(other._mapped, false);
+  }
+  return *this;
+}
+
+void LargeBuffer::release() {
+  if (_mapped) {
+    ::munmap(_data, _size);
+  } else {
+    std::free(_data);
+  }
+  _data = nullptr;
+  _size = 0;
+  _mapped = false;
+}
+
+void LargeBuffer::zero(int32_t threads) {
+  if (threads <= 0) {
+    threads = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+  }
+  threads = static_cast<int32_t>(std::clamp<std::size_t>(
+      _size / MIN_ZERO_CHUNK, 1, static_cast<std::size_t>(threads)));
+
+  // chunks are whole huge pages so no page is shared between threads
+  const std::size_t pages = _size / HUGE_PAGE_SIZE;
+  auto zeroChunk = [this, pages, threads](int32_t index) {
+    const std::size_t first = pages * index / threads;
+    const std::size_t last = pages * (index + 1) / threads;
+    std::memset(static_cast<char *>(_data) + first * HUGE_PAGE_SIZE, 0,
+                (last - first) * HUGE_PAGE_SIZE);
+  };
+
+  std::vector<std::thread> workers;
+  for (int32_t i = 1; i < threads; i++) {
+    workers.emplace_back(zeroChunk, i);
+  }
+  zeroChunk(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
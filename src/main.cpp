@@ -1,41 +1,36 @@
-#include "board.hpp"
-#include "evaluate.hpp"
-#include "search.hpp"
-#include "tree-search.hpp"
+#include "batch.hpp"
+#include "benchmark.hpp"
+#include "trace.hpp"
+#include "uci.hpp"
 
-#include <iostream>
-#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
 
-const std::string FEN_TO_USE =
-    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
-// ";
-// "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
+int main(int argc, char **argv) {
+  if (const char *trace_path = std::getenv("ELOCONQUEROR_TRACE")) {
+    Trace::enable(trace_path);
+  }
 
-int main() {
-  Evaluate::initTables();
-
-  Board board{FEN_TO_USE};
-  std::cout << TreeSearch::search(board, 5) << std::endl;
-  /*
-    std::string input;
-    std::string square;
-    while (true) {
-      std::cin >> input;
-
-      if (input == "move") {
-        std::cin >> square;
-        board = board.makeMove(square);
-      } else if (input == "perft") {
-        int32_t depth;
-        std::cin >> depth;
-        TreeSearch::search(board, depth);
-      } else if (input == "display") {
-        board.displayBoard();
-      } else if (input == "fen") {
-        std::getline(std::cin >> std::ws, square);
-        board = Board{square};
-      }
+  const std::string_view command = argc > 1 ? argv[1] : "";
+  int exit_code = 0;
+  if (command == "batch") {
+    Batch::Options options;
+    if (!Batch::parseOptions(argc - 2, argv + 2, options)) {
+      Batch::printUsage();
+      return 1;
     }
-  */
-  return 0;
+    exit_code = Batch::run(options);
+  } else if (command == "bench") {
+    const int32_t depth =
+        argc > 2 ? std::atoi(argv[2]) : Benchmark::DEFAULT_DEPTH;
+    const int32_t threads = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 1;
+    Benchmark::run(depth, threads);
+  } else {
+    UCI::loop();
+  }
+
+  // every command joins its search threads before it returns
+  Trace::dump();
+  return exit_code;
 }
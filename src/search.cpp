@@ -1,36 +1,28 @@
 #include "search.hpp"
 #include "board.hpp"
 #include "move.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include "undo_move.hpp"
 
 #include <array>
 #include <bit>
 
-template <std::size_t N>
-void generateMoves(const std::array<int8_t, N> &move_shift,
-                   const std::array<uint64_t, N> &move_shift_mask, Board &board,
+void generateMoves(const std::array<uint64_t, 64> &attacks, Board &board,
                    const int8_t piece_type, const bool turn,
                    const MoveType move_type, std::vector<Move> &moves) {
+  const uint64_t own_pieces = board.getAllPieces(turn);
   uint64_t piece_positions = board.getPiece(piece_type, turn);
 
   while (piece_positions) {
     const int8_t position = std::__countr_zero(piece_positions);
 
     const uint64_t from_bitboard_pos = (1LL << position);
-    uint64_t to_bitboard_pos = from_bitboard_pos;
-
-    for (size_t i{0}; i < N; i++) {
-      to_bitboard_pos = Board::shiftPosition(from_bitboard_pos, move_shift[i],
-                                             move_shift_mask[i]);
+    uint64_t targets = attacks[position] & ~own_pieces;
 
-      // piece is outside the bounds
-      if (to_bitboard_pos == 0)
-        continue;
-
-      // check if there is a piece of the same color on this square
-      if (board.isCellNotEmpty(to_bitboard_pos, turn)) {
-        continue;
-      }
+    while (targets) {
+      const uint64_t to_bitboard_pos = targets & -targets;
+      targets ^= to_bitboard_pos;
 
       // check if moving the piece leads to a check to our king
       UndoMove undo_move;
@@ -40,6 +32,7 @@ void generateMoves(const std::array<int8_t, N> &move_shift,
 
       if (board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn)) {
         board.unmakeMove(undo_move);
+        Stats::add(Stats::GENERATE_MOVES_REJECTED);
         continue;
       }
       board.unmakeMove(undo_move);
@@ -51,100 +44,152 @@ void generateMoves(const std::array<int8_t, N> &move_shift,
   }
 }
 
-void generatePawnMoves(Board &board, const bool turn,
+// adds the move if it does not leave our king in check
+inline void addIfLegal(Board &board, const bool turn, const Move &move,
                        std::vector<Move> &moves) {
-  static const std::array<MoveType, 4> move_types = {
-      MoveType::REGULAR_PAWN_CAPTURE, MoveType::PAWN_MOVE,
-      MoveType::REGULAR_PAWN_CAPTURE, MoveType::PAWN_MOVE_TWO_SQUARES};
+  UndoMove undo_move;
+  board.makeMove(move, undo_move);
+  const bool legal =
+      !board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn);
+  board.unmakeMove(undo_move);
+
+  if (legal) {
+    moves.push_back(move);
+  } else {
+    Stats::add(Stats::PAWN_MOVES_REJECTED);
+  }
+}
 
-  static const std::array<MoveType, 4> promotion_types = {
+/*
+ * Adds a pawn move for every bit of targets, coming from the square
+ * shift squares back. Only pawns in unsafe get the make/unmake test.
+ */
+inline void addPawnMoves(Board &board, const bool turn, uint64_t targets,
+                         const int8_t shift, const MoveType move_type,
+                         const uint64_t unsafe, std::vector<Move> &moves) {
+  static constexpr MoveType promotion_types[4] = {
       MoveType::PAWN_PROMOTE_QUEEN, MoveType::PAWN_PROMOTE_ROOK,
       MoveType::PAWN_PROMOTE_BISHOP, MoveType::PAWN_PROMOTE_KNIGHT};
-
-  const std::array<int32_t, 4> move_shift = {turn ? -9 : +7, turn ? -8 : +8,
-                                             turn ? -7 : +9, turn ? -16 : +16};
-  const std::array<uint64_t, 4> move_shift_mask = {
-      MoveExplorer::FILE_A | MoveExplorer::ROW_ONE | MoveExplorer::ROW_SEVEN,
-      MoveExplorer::ROW_ONE | MoveExplorer::ROW_SEVEN,
-      MoveExplorer::FILE_H | MoveExplorer::ROW_ONE | MoveExplorer::ROW_SEVEN,
-      turn ? (MoveExplorer::ROW_ONE_TWO) : (MoveExplorer::ROW_SIX_SEVEN),
-  };
-
-  const uint64_t start_row =
-      turn ? MoveExplorer::ROW_SIX : MoveExplorer::ROW_TWO;
-  const uint64_t finish_row =
+  const uint64_t last_row =
       turn ? MoveExplorer::ROW_ONE : MoveExplorer::ROW_SEVEN;
-  static const int8_t piece_type = Pieces::PAWN;
 
-  uint64_t piece_positions = board.getPiece(piece_type, turn);
+  while (targets) {
+    const int8_t to = std::countr_zero(targets);
+    targets &= targets - 1;
 
-  while (piece_positions) {
-    const int8_t position = std::__countr_zero(piece_positions);
-
-    const uint64_t from_bitboard_pos = (1LL << position);
-
-    for (std::size_t i{0}; i < move_types.size(); i++) {
-      const uint64_t to_bitboard_pos = Board::shiftPosition(
-          from_bitboard_pos, move_shift[i], move_shift_mask[i]);
-
-      if (to_bitboard_pos == 0) {
-        continue;
-      }
-
-      // check if there is a piece of the same color on this square
-      if (board.isCellNotEmpty(to_bitboard_pos, turn)) {
-        continue;
-      }
+    const uint64_t to_pos = uint64_t{1} << to;
+    const uint64_t from_pos = uint64_t{1} << (to - shift);
+    Move move{from_pos, to_pos, Pieces::PAWN, move_type};
 
+    if (from_pos & unsafe) {
       UndoMove undo_move;
-      // check if moving the piece leads to a check to our king
-      Move move_to_make = Move{from_bitboard_pos, to_bitboard_pos,
-                               Pieces{piece_type}, move_types[i]};
-      board.makeMove(move_to_make, undo_move);
-
-      if (board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn)) {
-        board.unmakeMove(undo_move);
-        continue;
-      }
+      board.makeMove(move, undo_move);
+      const bool legal =
+          !board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn);
       board.unmakeMove(undo_move);
-
-      bool no_blockers_check = true;
-
-      if (i == 3) {
-        uint64_t in_between_cell = to_bitboard_pos;
-        if (turn) {
-          in_between_cell <<= 8;
-        } else {
-          in_between_cell >>= 8;
-        }
-        if ((from_bitboard_pos & start_row) == 0 ||
-            board.isCellNotEmpty(in_between_cell, 0) ||
-            board.isCellNotEmpty(in_between_cell, 1)) {
-          continue;
-        }
-      }
-
-      // this means there must an enemy piece there to capture
-      if ((i == 0 || i == 2) &&
-          ((!board.isCellNotEmpty(to_bitboard_pos, turn ^ 1) &&
-            !board.isEnPassant(to_bitboard_pos, turn)))) {
-        continue;
-      } else if ((i == 1 || i == 3) &&
-                 board.isCellNotEmpty(to_bitboard_pos, turn ^ 1)) {
+      if (!legal) {
+        Stats::add(Stats::PAWN_MOVES_REJECTED);
         continue;
       }
+    }
 
-      if ((to_bitboard_pos & finish_row) != 0) {
-        for (const auto &promotion_type : promotion_types) {
-          move_to_make.move_type = promotion_type;
-          moves.push_back(move_to_make);
-        }
-      } else {
-        moves.push_back(move_to_make);
+    if (to_pos & last_row) {
+      for (const MoveType promotion_type : promotion_types) {
+        move.move_type = promotion_type;
+        moves.push_back(move);
       }
+    } else {
+      moves.push_back(move);
     }
+  }
+}
 
-    piece_positions ^= (uint64_t{1} << position);
+/*
+ * All pawns are moved at once by shifting the whole bitboard. Legality is
+ * only probed for pawns that could be pinned, or for every pawn when
+ * the king is in check.
+ */
+void generatePawnMoves(Board &board, const bool turn,
+                       std::vector<Move> &moves) {
+  constexpr uint64_t ROW_THREE = 0x0000000000FF0000ULL;
+  constexpr uint64_t ROW_FIVE = 0x0000FF0000000000ULL;
+
+  const uint64_t pawns = board.getPiece(Pieces::PAWN, turn);
+  const uint64_t enemy = board.getAllPieces(turn ^ 1);
+  const uint64_t empty = ~(board.getAllPieces(turn) | enemy);
+
+  const uint64_t king = board.getPiece(Pieces::KING, turn);
+  const int8_t king_square = std::countr_zero(king);
+
+  // pawns on a line between our king and an enemy slider may be pinned
+  uint64_t unsafe = 0;
+  if (board.isInCheck()) {
+    unsafe = ~uint64_t{0};
+  } else {
+    const uint64_t queens = board.getPiece(Pieces::QUEEN, turn ^ 1);
+    if (MoveExplorer::line_rays[king_square] &
+        (board.getPiece(Pieces::ROOK, turn ^ 1) | queens)) {
+      unsafe |= MoveExplorer::line_rays[king_square];
+    }
+    if (MoveExplorer::diag_rays[king_square] &
+        (board.getPiece(Pieces::BISHOP, turn ^ 1) | queens)) {
+      unsafe |= MoveExplorer::diag_rays[king_square];
+    }
+  }
+
+  // shifts are towards the enemy, captures are named by the file they go to
+  uint64_t single_push;
+  uint64_t double_push;
+  uint64_t capture_left;
+  uint64_t capture_right;
+  int8_t push_shift;
+  int8_t left_shift;
+  int8_t right_shift;
+  if (turn == 0) {
+    push_shift = +8;
+    left_shift = +7;
+    right_shift = +9;
+    single_push = (pawns << 8) & empty;
+    double_push = ((single_push & ROW_THREE) << 8) & empty;
+    capture_left = (pawns << 7) & ~MoveExplorer::FILE_H & enemy;
+    capture_right = (pawns << 9) & ~MoveExplorer::FILE_A & enemy;
+  } else {
+    push_shift = -8;
+    left_shift = -9;
+    right_shift = -7;
+    single_push = (pawns >> 8) & empty;
+    double_push = ((single_push & ROW_FIVE) >> 8) & empty;
+    capture_left = (pawns >> 9) & ~MoveExplorer::FILE_H & enemy;
+    capture_right = (pawns >> 7) & ~MoveExplorer::FILE_A & enemy;
+  }
+
+  addPawnMoves(board, turn, capture_left, left_shift,
+               MoveType::REGULAR_PAWN_CAPTURE, unsafe, moves);
+  addPawnMoves(board, turn, capture_right, right_shift,
+               MoveType::REGULAR_PAWN_CAPTURE, unsafe, moves);
+  addPawnMoves(board, turn, single_push, push_shift, MoveType::PAWN_MOVE,
+               unsafe, moves);
+  addPawnMoves(board, turn, double_push, push_shift * 2,
+               MoveType::PAWN_MOVE_TWO_SQUARES, unsafe, moves);
+
+  /*
+   * En passant removes two pawns from one row, so it can expose the king
+   * along that row even when neither pawn is pinned on its own. It is
+   * always checked by playing it.
+   */
+  const uint64_t en_passant = board.getLastMoveTwoSquaresPushPawn();
+  if (en_passant) {
+    uint64_t capturers =
+        MoveExplorer::pawn_attacks[turn ^ 1][std::countr_zero(en_passant)] &
+        pawns;
+    while (capturers) {
+      const uint64_t from_pos = capturers & -capturers;
+      capturers ^= from_pos;
+      addIfLegal(board, turn,
+                 Move{from_pos, en_passant, Pieces::PAWN,
+                      MoveType::REGULAR_PAWN_CAPTURE},
+                 moves);
+    }
   }
 }
 
@@ -178,6 +223,7 @@ void moveIncrementally(Board &board, const bool turn, const int8_t piece_type,
         board.makeMove(move_to_make, undo_move);
 
         if (board.isUnderCheck(board.getPiece(Pieces::KING, turn), turn)) {
+          Stats::add(Stats::MOVE_INCREMENTALLY_REJECTED);
           // there is a piece of the opposite color
           if (is_cell_empty) {
             board.unmakeMove(undo_move);
@@ -208,6 +254,8 @@ void moveIncrementally(Board &board, const bool turn, const int8_t piece_type,
 
 void MoveExplorer::searchAllMoves(Board &board, const bool turn,
                                   std::vector<Move> &moves) {
+  const Trace::Scope scope("movegen");
+
   searchKingMoves(board, turn, moves);
 
   searchQueenMoves(board, turn, moves);
@@ -221,82 +269,43 @@ void MoveExplorer::searchAllMoves(Board &board, const bool turn,
   searchPawnMoves(board, turn, moves);
 }
 
-template <std::size_t N>
-bool anyCellIsUnderAttack(Board &board,
-                          const std::array<uint64_t, N> &cells_to_check,
-                          const bool turn) {
-
-  for (const uint64_t cell_to_check : cells_to_check)
-    if (board.isUnderCheck(cell_to_check, turn)) {
-      return true;
-    }
-  return false;
-}
-
-template <std::size_t N>
-bool cellsAreFree(Board &board, const std::array<uint64_t, N> &cells_to_check) {
-  for (const uint64_t cell_to_check : cells_to_check) {
-    if (board.isCellNotEmpty(cell_to_check, 0) ||
-        board.isCellNotEmpty(cell_to_check, 1)) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
 void generateCastleMoves(Board &board, bool turn, std::vector<Move> &moves) {
-  // generate all attacked squares by the enemy
-  // std::vector<Move> attacked_squares;
-  // attacked_squares.resize(2);
-
-  // MoveExplorer::searchAllMoves(board, turn ^ 1, attacked_squares);
-
-  const int8_t row_to_use = turn ? 7 : 0;
-  // check short castle
-  if (board.checkCastlingRights(turn, 1)) {
-    const std::array<uint64_t, 3> cells_to_check = {
-        Board::getPositionAsBitboard(row_to_use, 4),
-        Board::getPositionAsBitboard(row_to_use, 5),
-        Board::getPositionAsBitboard(row_to_use, 6)};
-
-    const std::array<uint64_t, 2> cells_to_check_if_free = {cells_to_check[1],
-                                                            cells_to_check[2]};
-
-    if (!anyCellIsUnderAttack(board, cells_to_check, turn) &&
-        cellsAreFree(board, cells_to_check_if_free)) {
-      moves.push_back(Move{cells_to_check[0], cells_to_check[2], Pieces::KING,
-                           MoveType::SHORT_CASTLE_KING_MOVE});
-    }
+  // castling out of check is never allowed
+  if (board.isInCheck() || !(board.getCastlingRights() & (3 << (turn * 2)))) {
+    return;
   }
-  if (board.checkCastlingRights(turn, 0)) {
-    const std::array<uint64_t, 3> cells_to_check = {
-        Board::getPositionAsBitboard(row_to_use, 2),
-        Board::getPositionAsBitboard(row_to_use, 3),
-        Board::getPositionAsBitboard(row_to_use, 4),
-    };
-    const std::array<uint64_t, 3> cells_to_check_if_free = {
-        Board::getPositionAsBitboard(row_to_use, 1), cells_to_check[0],
-        cells_to_check[1]};
-    if (!anyCellIsUnderAttack(board, cells_to_check, turn) &&
-        cellsAreFree(board, cells_to_check_if_free)) {
-      moves.push_back(Move{cells_to_check[2], cells_to_check[0], Pieces::KING,
-                           MoveType::LONG_CASTLE_KING_MOVE});
+
+  const uint64_t occupancy = board.getAllPieces(0) | board.getAllPieces(1);
+  const uint64_t king = board.getPiece(Pieces::KING, turn);
+  for (const bool castle_type : {true, false}) {
+    if (board.checkCastlingRights(turn, castle_type) &&
+        !(occupancy & MoveExplorer::castle_empty[turn][castle_type]) &&
+        !board.isAnyAttacked(MoveExplorer::castle_safe[turn][castle_type],
+                             turn)) {
+      moves.push_back(
+          Move{king, MoveExplorer::castle_king_to[turn][castle_type],
+               Pieces::KING,
+               castle_type ? MoveType::SHORT_CASTLE_KING_MOVE
+                           : MoveType::LONG_CASTLE_KING_MOVE});
     }
   }
 }
 
 void MoveExplorer::searchKingMoves(Board &board, const bool turn,
                                    std::vector<Move> &moves) {
+  const std::size_t moves_before = moves.size();
 
   generateCastleMoves(board, turn, moves);
 
-  generateMoves(combined_shifts, combined_shifts_masks, board, Pieces::KING,
-                turn, MoveType::REGULAR_KING_MOVE, moves);
+  generateMoves(king_attacks, board, Pieces::KING, turn,
+                MoveType::REGULAR_KING_MOVE, moves);
+
+  Stats::add(Stats::KING_MOVES, moves.size() - moves_before);
 }
 
 void MoveExplorer::searchQueenMoves(Board &board, const bool turn,
                                     std::vector<Move> &moves) {
+  const std::size_t moves_before = moves.size();
   // get diagonal moves
   moveIncrementally(board, turn, Pieces::QUEEN, MoveExplorer::move_diag_shifts,
                     MoveExplorer::move_diag_shifts_masks, MoveType::QUEEN_MOVE,
@@ -306,32 +315,46 @@ void MoveExplorer::searchQueenMoves(Board &board, const bool turn,
   moveIncrementally(board, turn, Pieces::QUEEN, MoveExplorer::move_line_shifts,
                     MoveExplorer::move_line_shifts_masks, MoveType::QUEEN_MOVE,
                     moves);
+
+  Stats::add(Stats::QUEEN_MOVES, moves.size() - moves_before);
 }
 
 void MoveExplorer::searchRookMoves(Board &board, const bool turn,
                                    std::vector<Move> &moves) {
+  const std::size_t moves_before = moves.size();
 
   // get line moves
   moveIncrementally(board, turn, Pieces::ROOK, MoveExplorer::move_line_shifts,
                     MoveExplorer::move_line_shifts_masks, MoveType::ROOK_MOVE,
                     moves);
+
+  Stats::add(Stats::ROOK_MOVES, moves.size() - moves_before);
 }
 
 void MoveExplorer::searchBishopMoves(Board &board, const bool turn,
                                      std::vector<Move> &moves) {
+  const std::size_t moves_before = moves.size();
   // get diagonal moves
   moveIncrementally(board, turn, Pieces::BISHOP, MoveExplorer::move_diag_shifts,
                     MoveExplorer::move_diag_shifts_masks, MoveType::BISHOP_MOVE,
                     moves);
+
+  Stats::add(Stats::BISHOP_MOVES, moves.size() - moves_before);
 }
 
 void MoveExplorer::searchKnightMoves(Board &board, const bool turn,
                                      std::vector<Move> &moves) {
-  generateMoves(knight_move_shifts, knight_move_shifts_masks, board,
-                Pieces::KNIGHT, turn, MoveType::KNIGHT_MOVE, moves);
+  const std::size_t moves_before = moves.size();
+  generateMoves(knight_attacks, board, Pieces::KNIGHT, turn,
+                MoveType::KNIGHT_MOVE, moves);
+
+  Stats::add(Stats::KNIGHT_MOVES, moves.size() - moves_before);
 }
 
 void MoveExplorer::searchPawnMoves(Board &board, const bool turn,
                                    std::vector<Move> &moves) {
+  const std::size_t moves_before = moves.size();
   generatePawnMoves(board, turn, moves);
+
+  Stats::add(Stats::PAWN_MOVES, moves.size() - moves_before);
 }
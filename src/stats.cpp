@@ -0,0 +1,118 @@
+#include "stats.hpp"
+
+#ifdef ELOCONQUEROR_STATS
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+constexpr const char *counter_names[Stats::COUNTER_COUNT] = {
+    "king moves",
+    "queen moves",
+    "rook moves",
+    "bishop moves",
+    "knight moves",
+    "pawn moves",
+    "generateMoves rejected",
+    "moveIncrementally rejected",
+    "pawn moves rejected",
+    "isUnderCheck calls",
+    "makeMove calls",
+    "unmakeMove calls",
+    "TT probes",
+    "TT hits",
+    "tablebase hits",
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<Stats::ThreadCounters *> live;
+  // counters of threads that already exited
+  uint64_t retired[Stats::COUNTER_COUNT] = {};
+  uint64_t retired_cutoffs[Stats::CUTOFF_BUCKETS] = {};
+};
+
+Registry &registry() {
+  // leaked so thread_local destructors running at exit can still use it
+  static Registry *instance = new Registry;
+  return *instance;
+}
+} // namespace
+
+Stats::ThreadCounters::ThreadCounters() {
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  reg.live.push_back(this);
+}
+
+Stats::ThreadCounters::~ThreadCounters() {
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  for (int32_t i = 0; i < COUNTER_COUNT; i++) {
+    reg.retired[i] += counters[i].load(std::memory_order_relaxed);
+  }
+  for (int32_t i = 0; i < CUTOFF_BUCKETS; i++) {
+    reg.retired_cutoffs[i] += cutoffs[i].load(std::memory_order_relaxed);
+  }
+  std::erase(reg.live, this);
+}
+
+Stats::ThreadCounters &Stats::local() {
+  thread_local ThreadCounters counters;
+  return counters;
+}
+
+void Stats::print(std::ostream &out) {
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+
+  uint64_t totals[COUNTER_COUNT];
+  uint64_t cutoffs[CUTOFF_BUCKETS];
+  std::copy(std::begin(reg.retired), std::end(reg.retired), totals);
+  std::copy(std::begin(reg.retired_cutoffs), std::end(reg.retired_cutoffs),
+            cutoffs);
+  for (const ThreadCounters *thread : reg.live) {
+    for (int32_t i = 0; i < COUNTER_COUNT; i++) {
+      totals[i] += thread->counters[i].load(std::memory_order_relaxed);
+    }
+    for (int32_t i = 0; i < CUTOFF_BUCKETS; i++) {
+      cutoffs[i] += thread->cutoffs[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  for (int32_t i = 0; i < COUNTER_COUNT; i++) {
+    out << counter_names[i] << ": " << totals[i] << "\n";
+  }
+
+  uint64_t total_cutoffs = 0;
+  for (const uint64_t count : cutoffs) {
+    total_cutoffs += count;
+  }
+  out << "beta cutoffs: " << total_cutoffs << "\n";
+  for (int32_t i = 0; i < CUTOFF_BUCKETS; i++) {
+    out << "  move " << i << (i == CUTOFF_BUCKETS - 1 ? "+" : "") << ": "
+        << cutoffs[i] << " ("
+        << (total_cutoffs ? cutoffs[i] * 100.0 / total_cutoffs : 0.0)
+        << "%)\n";
+  }
+}
+
+void Stats::reset() {
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+
+  std::fill(std::begin(reg.retired), std::end(reg.retired), 0);
+  std::fill(std::begin(reg.retired_cutoffs), std::end(reg.retired_cutoffs),
+            0);
+  for (ThreadCounters *thread : reg.live) {
+    for (auto &counter : thread->counters) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &counter : thread->cutoffs) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+#endif
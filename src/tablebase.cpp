@@ -0,0 +1,132 @@
+#include "tablebase.hpp"
+
+#include <bit>
+#include <mutex>
+
+#ifdef ELOCONQUEROR_SYZYGY
+extern "C" {
+#include "tbprobe.h"
+}
+
+namespace {
+struct ProbePosition {
+  uint64_t white;
+  uint64_t black;
+  uint64_t kings;
+  uint64_t queens;
+  uint64_t rooks;
+  uint64_t bishops;
+  uint64_t knights;
+  uint64_t pawns;
+  unsigned ep;
+  bool white_to_move;
+};
+
+// Fathom wants a bitboard per colour and per piece type, a1 = bit 0 like ours
+ProbePosition toProbePosition(const Board &board) {
+  ProbePosition position{};
+  uint64_t *by_type[Board::ALL_PIECE_TYPES] = {
+      &position.kings,   &position.queens,  &position.rooks,
+      &position.bishops, &position.knights, &position.pawns};
+
+  for (int8_t colour = 0; colour < 2; colour++) {
+    uint64_t &by_colour = colour ? position.black : position.white;
+    for (int8_t piece = 0; piece < Board::ALL_PIECE_TYPES; piece++) {
+      const uint64_t pieces = board.getPiece(piece, colour);
+      *by_type[piece] |= pieces;
+      by_colour |= pieces;
+    }
+  }
+
+  const uint64_t en_passant = board.getLastMoveTwoSquaresPushPawn();
+  position.ep = en_passant ? std::countr_zero(en_passant) : 0;
+  position.white_to_move = board.getPlayerTurn() == 0;
+  return position;
+}
+
+constexpr char promotion_suffix[5] = {'\0', 'q', 'r', 'b', 'n'};
+
+// Fathom documents tb_probe_root as not thread-safe, unlike tb_probe_wdl
+std::mutex root_probe_mutex;
+} // namespace
+
+bool Tablebase::init(const std::string &path) {
+  if (path.empty()) {
+    tb_free();
+    return true;
+  }
+  return tb_init(path.c_str()) && TB_LARGEST > 0;
+}
+
+int32_t Tablebase::largest() { return static_cast<int32_t>(TB_LARGEST); }
+
+bool Tablebase::probeWdl(const Board &board, Wdl &wdl) {
+  if (board.getCastlingRights() != 0 || board.getHalfmoveClock() != 0) {
+    return false;
+  }
+
+  const ProbePosition position = toProbePosition(board);
+  const unsigned result = tb_probe_wdl(
+      position.white, position.black, position.kings, position.queens,
+      position.rooks, position.bishops, position.knights, position.pawns, 0,
+      0, position.ep, position.white_to_move);
+  if (result == TB_RESULT_FAILED) {
+    return false;
+  }
+
+  wdl = static_cast<Wdl>(result);
+  return true;
+}
+
+bool Tablebase::probeRoot(const Board &board, Move &move, Wdl &wdl) {
+  if (board.getCastlingRights() != 0) {
+    return false;
+  }
+
+  const ProbePosition position = toProbePosition(board);
+  unsigned result;
+  {
+    std::lock_guard lock(root_probe_mutex);
+    result = tb_probe_root(
+        position.white, position.black, position.kings, position.queens,
+        position.rooks, position.bishops, position.knights, position.pawns,
+        board.getHalfmoveClock(), 0, position.ep, position.white_to_move,
+        nullptr);
+  }
+  if (result == TB_RESULT_FAILED || result == TB_RESULT_CHECKMATE ||
+      result == TB_RESULT_STALEMATE) {
+    return false;
+  }
+
+  char uci[Move::MAX_FORMATTED_LENGTH];
+  Board::positionAsChessSquare(uint64_t{1} << TB_GET_FROM(result), uci);
+  Board::positionAsChessSquare(uint64_t{1} << TB_GET_TO(result), uci + 2);
+  const unsigned promotion = TB_GET_PROMOTES(result);
+  uci[4] = promotion_suffix[promotion];
+
+  Board scratch = board;
+  if (!scratch.parseMove(std::string_view(uci, promotion ? 5 : 4), move)) {
+    return false;
+  }
+  wdl = static_cast<Wdl>(TB_GET_WDL(result));
+  return true;
+}
+#else
+bool Tablebase::init(const std::string &path) { return path.empty(); }
+
+int32_t Tablebase::largest() { return 0; }
+
+bool Tablebase::probeWdl(const Board &, Wdl &) { return false; }
+
+bool Tablebase::probeRoot(const Board &, Move &, Wdl &) { return false; }
+#endif
+
+int32_t Tablebase::pieceCount(const Board &board) {
+  int32_t count = 0;
+  for (int8_t colour = 0; colour < 2; colour++) {
+    for (int8_t piece = 0; piece < Board::ALL_PIECE_TYPES; piece++) {
+      count += std::popcount(board.getPiece(piece, colour));
+    }
+  }
+  return count;
+}
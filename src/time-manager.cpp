@@ -0,0 +1,121 @@
+#include "time-manager.hpp"
+
+#include <algorithm>
+
+namespace {
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+// assumed game length when the GUI does not send movestogo
+constexpr int64_t DEFAULT_MOVES_TO_GO = 30;
+// the hard limit may exceed the soft limit this many times over
+constexpr int64_t HARD_LIMIT_FACTOR = 4;
+
+// target time between two clock reads
+constexpr int64_t POLL_PERIOD_US = 1000;
+constexpr uint64_t MIN_POLL_INTERVAL = 128;
+constexpr uint64_t MAX_POLL_INTERVAL = 65536;
+
+/*
+ * Scales the soft limit by how many iterations in a row kept the same
+ * best move, in percent. A fresh change buys more time, a move that has
+ * survived several iterations lets us play early.
+ */
+constexpr int64_t stability_scale[] = {200, 140, 110, 90, 75, 60};
+constexpr int32_t MAX_STABILITY =
+    sizeof(stability_scale) / sizeof(stability_scale[0]) - 1;
+} // namespace
+
+TimeManager::TimeManager(const TreeSearch::SearchLimits &limits, bool turn)
+    : _start_time(Clock::now()), _soft_limit(0), _hard_limit(0),
+      _has_time_limit(true), _fixed_time(false),
+      _next_check(MIN_POLL_INTERVAL),
+      _last_best_move{}, _stable_iterations(0) {
+
+  if (limits.infinite) {
+    _has_time_limit = false;
+  } else if (limits.move_time > 0) {
+    _soft_limit = _hard_limit = milliseconds(limits.move_time);
+    _fixed_time = true;
+  } else if (limits.time_left[turn] > 0) {
+    const int64_t usable =
+        std::max<int64_t>(limits.time_left[turn] - MOVE_OVERHEAD_MS, 1);
+    const int64_t moves_to_go =
+        limits.moves_to_go ? limits.moves_to_go : DEFAULT_MOVES_TO_GO;
+
+    const int64_t hard = std::min(usable * 3 / 4, usable / moves_to_go *
+                                                      HARD_LIMIT_FACTOR +
+                                                  limits.increment[turn]);
+    const int64_t soft =
+        std::min(usable / moves_to_go + limits.increment[turn] * 3 / 4, hard);
+
+    _soft_limit = milliseconds(std::max<int64_t>(soft, 1));
+    _hard_limit = milliseconds(std::max<int64_t>(hard, 1));
+  } else {
+    _has_time_limit = false;
+  }
+
+  if (!_has_time_limit) {
+    _next_check = UINT64_MAX;
+  }
+}
+
+bool TimeManager::pollClock(uint64_t nodes) {
+  const microseconds elapsed =
+      std::chrono::duration_cast<microseconds>(Clock::now() - _start_time);
+  if (elapsed >= _hard_limit) {
+    return true;
+  }
+
+  // read the clock again in about POLL_PERIOD_US at the current node rate,
+  // sooner if the hard limit is closer than that
+  const int64_t period =
+      std::min(POLL_PERIOD_US, (_hard_limit - elapsed).count() / 2);
+  const uint64_t interval =
+      nodes * std::max<int64_t>(period, 1) /
+      std::max<int64_t>(elapsed.count(), 1);
+  _next_check =
+      nodes + std::clamp(interval, MIN_POLL_INTERVAL, MAX_POLL_INTERVAL);
+  return false;
+}
+
+bool TimeManager::softLimitReached(const Move &best_move) {
+  if (best_move == _last_best_move) {
+    _stable_iterations = std::min(_stable_iterations + 1, MAX_STABILITY);
+  } else {
+    _stable_iterations = 0;
+    _last_best_move = best_move;
+  }
+
+  if (!_has_time_limit || _fixed_time) {
+    return false;
+  }
+
+  const microseconds scaled_limit =
+      _soft_limit * stability_scale[_stable_iterations] / 100;
+  const microseconds elapsed =
+      std::chrono::duration_cast<microseconds>(Clock::now() - _start_time);
+  return elapsed >= std::min(scaled_limit, _hard_limit);
+}
+
+void TimeManager::restart(uint64_t nodes) {
+  _start_time = Clock::now();
+  if (_has_time_limit) {
+    _next_check = nodes + MIN_POLL_INTERVAL;
+  }
+}
+
+bool TimeManager::hasTimeLimit() const { return _has_time_limit; }
+
+int64_t TimeManager::elapsedMs() const {
+  return std::chrono::duration_cast<milliseconds>(Clock::now() - _start_time)
+      .count();
+}
+
+int64_t TimeManager::softLimitMs() const {
+  return std::chrono::duration_cast<milliseconds>(_soft_limit).count();
+}
+
+int64_t TimeManager::hardLimitMs() const {
+  return std::chrono::duration_cast<milliseconds>(_hard_limit).count();
+}
@@ -0,0 +1,154 @@
+#include "trace.hpp"
+
+#ifdef ELOCONQUEROR_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> Trace::recording{false};
+
+namespace {
+constexpr std::size_t RING_SIZE = std::size_t{1} << 16;
+
+struct Event {
+  const char *name;
+  int64_t start;
+  int64_t end;
+};
+
+struct Ring {
+  explicit Ring(int32_t tid_) : tid(tid_), events(RING_SIZE) {}
+
+  const int32_t tid;
+  std::vector<Event> events;
+  // total events ever written, the ring holds the last RING_SIZE
+  uint64_t written = 0;
+  bool in_use = true;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Ring>> rings;
+  std::string path;
+  int64_t origin = 0;
+};
+
+Registry &registry() {
+  // leaked so thread exits during shutdown can still use it
+  static Registry *instance = new Registry;
+  return *instance;
+}
+
+/*
+ * Search threads are created for every search, so the ring of a thread
+ * that exited is handed to the next new thread instead of growing the
+ * registry. Their events never overlap in time.
+ */
+struct RingOwner {
+  RingOwner() {
+    Registry &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    for (const auto &candidate : reg.rings) {
+      if (!candidate->in_use) {
+        candidate->in_use = true;
+        ring = candidate.get();
+        return;
+      }
+    }
+    reg.rings.push_back(
+        std::make_unique<Ring>(static_cast<int32_t>(reg.rings.size())));
+    ring = reg.rings.back().get();
+  }
+
+  ~RingOwner() {
+    std::lock_guard lock(registry().mutex);
+    ring->in_use = false;
+  }
+
+  Ring *ring;
+};
+
+void writeString(std::FILE *file, const char *text) {
+  std::fputc('"', file);
+  for (; *text; text++) {
+    if (*text == '"' || *text == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*text, file);
+  }
+  std::fputc('"', file);
+}
+} // namespace
+
+int64_t Trace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Trace::record(const char *name, int64_t start, int64_t end) {
+  thread_local RingOwner owner;
+  Ring &ring = *owner.ring;
+  ring.events[ring.written % RING_SIZE] = Event{name, start, end};
+  ring.written++;
+}
+
+bool Trace::enable(const char *path) {
+  Registry &reg = registry();
+  {
+    std::lock_guard lock(reg.mutex);
+    if (!reg.path.empty()) {
+      return false;
+    }
+    reg.path = path;
+    reg.origin = now();
+  }
+
+  recording.store(true);
+  return true;
+}
+
+void Trace::dump() {
+  recording.store(false);
+
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  if (reg.path.empty()) {
+    return;
+  }
+
+  std::FILE *file = std::fopen(reg.path.c_str(), "w");
+  if (!file) {
+    std::fprintf(stderr, "trace: cannot write %s\n", reg.path.c_str());
+    return;
+  }
+
+  std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+  bool first = true;
+  for (const auto &ring : reg.rings) {
+    const uint64_t count = std::min<uint64_t>(ring->written, RING_SIZE);
+    for (uint64_t i = ring->written - count; i < ring->written; i++) {
+      const Event &event = ring->events[i % RING_SIZE];
+      std::fputs(first ? "" : ",\n", file);
+      first = false;
+
+      std::fputs("{\"name\":", file);
+      writeString(file, event.name);
+      // timestamps are in microseconds
+      std::fprintf(file,
+                   ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                   "\"dur\":%.3f}",
+                   ring->tid, (event.start - reg.origin) / 1000.0,
+                   (event.end - event.start) / 1000.0);
+    }
+  }
+  std::fputs("\n]}\n", file);
+  std::fclose(file);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "transposition-table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace {
+/*
+ * data layout:
+ * bits  0-19 packed move + 1 (0 means no move)
+ * bits 20-35 score
+ * bits 36-43 depth
+ * bits 44-45 bound
+ */
+uint64_t packData(int32_t depth, int32_t score, Bound bound,
+                  const Move *move) {
+  const uint64_t packed_move = move ? uint64_t{move->pack()} + 1 : 0;
+  return packed_move | (uint64_t(uint16_t(int16_t(score))) << 20) |
+         (uint64_t(uint8_t(depth)) << 36) | (uint64_t(bound) << 44);
+}
+} // namespace
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+  resize(megabytes);
+}
+
+void TranspositionTable::resize(std::size_t megabytes) {
+  std::size_t slots = (megabytes << 20) / sizeof(Slot);
+  // keep the size a power of two so indexing is a single AND
+  slots = slots ? std::bit_floor(slots) : 1;
+
+  // allocated before the old table is let go, if it throws the table is
+  // left as it was
+  LargeBuffer memory{slots * sizeof(Slot)};
+  _memory = std::move(memory);
+  // lock-free atomics are plain words, all zero bits is a valid empty slot
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+  _slots = static_cast<Slot *>(_memory.data());
+  _mask = slots - 1;
+  clear();
+}
+
+void TranspositionTable::clear() { _memory.zero(); }
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const {
+  const Slot &slot = slotFor(key);
+  const uint64_t data = slot.data.load(std::memory_order_relaxed);
+  const uint64_t key_xor_data =
+      slot.key_xor_data.load(std::memory_order_relaxed);
+
+  if ((key_xor_data ^ data) != key) {
+    return false;
+  }
+
+  entry.bound = Bound((data >> 44) & 3);
+  if (entry.bound == Bound::NONE) {
+    return false;
+  }
+
+  const uint32_t packed_move = data & 0xFFFFF;
+  entry.has_move = packed_move != 0;
+  if (entry.has_move) {
+    entry.move = Move::unpack(packed_move - 1);
+  }
+  entry.score = int16_t((data >> 20) & 0xFFFF);
+  entry.depth = int8_t((data >> 36) & 0xFF);
+  return true;
+}
+
+void TranspositionTable::store(uint64_t key, int32_t depth, int32_t score,
+                               Bound bound, const Move *move) {
+  // keep the previous best move if this search did not produce one
+  TTEntry old_entry;
+  if (move == nullptr && probe(key, old_entry) && old_entry.has_move) {
+    move = &old_entry.move;
+  }
+
+  // a check extension can take a search one past the largest packed depth
+  Slot &slot = slotFor(key);
+  const uint64_t data =
+      packData(std::min(depth, MAX_DEPTH), score, bound, move);
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+}
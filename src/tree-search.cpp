@@ -1,51 +1,652 @@
 #include "tree-search.hpp"
 #include "evaluate.hpp"
 #include "search.hpp"
+#include "stats.hpp"
+#include "tablebase.hpp"
+#include "time-manager.hpp"
+#include "trace.hpp"
+#include "transposition-table.hpp"
 #include "undo_move.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <span>
+#include <thread>
+
+namespace {
+// everything the search keeps for one ply
+struct SearchStack {
+  SearchStack() {
+    moves.reserve(256);
+    move_scores.reserve(256);
+  }
+
+  std::vector<Move> moves;
+  std::vector<int32_t> move_scores;
+  // the next move to play, only used by perft
+  std::size_t index = 0;
+  UndoMove undo_move;
+  Move killers[2] = {};
+};
+} // namespace
+
 uint64_t TreeSearch::search(Board &board, int32_t depth) {
-  std::vector<Move> new_moves[10];
-  int32_t visited[10] = {0};
-  for (int32_t i = 0; i < 10; i++) {
-    new_moves[i].reserve(256);
+  const Trace::Scope scope("perft");
+
+  if (depth <= 0) {
+    return 1;
   }
 
-  int64_t cnt = 0;
-  int32_t cur_depth = depth;
-  std::array<UndoMove, 10> undo_moves;
+  std::vector<SearchStack> stack(depth);
+  uint64_t nodes = 0;
+  int32_t ply = 0;
 
-  MoveExplorer::searchAllMoves(board, board.getPlayerTurn(), new_moves[depth]);
+  MoveExplorer::searchAllMoves(board, board.getPlayerTurn(), stack[0].moves);
   while (true) {
-    if (cur_depth == 0) {
-      cnt += 1;
-      cur_depth++;
-
-      board.unmakeMove(undo_moves[cur_depth]);
+    SearchStack &entry = stack[ply];
+    if (entry.index == entry.moves.size()) {
+      if (ply == 0) {
+        break;
+      }
+      ply--;
+      board.unmakeMove(stack[ply].undo_move);
+      continue;
+    }
 
+    board.makeMove(entry.moves[entry.index++], entry.undo_move);
+    if (ply + 1 == depth) {
+      nodes++;
+      board.unmakeMove(entry.undo_move);
       continue;
-    } else if (visited[cur_depth] == new_moves[cur_depth].size()) {
-      cur_depth++;
-      if (cur_depth > depth) {
-        break;
+    }
+
+    ply++;
+    stack[ply].moves.clear();
+    stack[ply].index = 0;
+    MoveExplorer::searchAllMoves(board, board.getPlayerTurn(),
+                                 stack[ply].moves);
+  }
+
+  return nodes;
+}
+
+namespace {
+// boards[0] is the position to expand, boards[1] receives each child
+uint64_t perftCopyMake(Board *boards, std::vector<Move> *moves,
+                       int32_t depth) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  const Board &board = boards[0];
+  std::vector<Move> &position_moves = moves[0];
+  position_moves.clear();
+  MoveExplorer::searchAllMoves(boards[0], board.getPlayerTurn(),
+                               position_moves);
+
+  uint64_t nodes = 0;
+  for (const Move &move : position_moves) {
+    boards[1] = board;
+    boards[1].makeMove(move);
+    nodes += perftCopyMake(boards + 1, moves + 1, depth - 1);
+  }
+  return nodes;
+}
+} // namespace
+
+uint64_t TreeSearch::searchCopyMake(const Board &board, int32_t depth) {
+  const Trace::Scope scope("perft copy-make");
+
+  depth = std::max(depth, 0);
+  std::vector<Board> boards(depth + 1, board);
+  std::vector<std::vector<Move>> moves(depth + 1);
+  for (std::vector<Move> &position_moves : moves) {
+    position_moves.reserve(256);
+  }
+
+  return perftCopyMake(boards.data(), moves.data(), depth);
+}
+
+namespace {
+using TreeSearch::INF_SCORE;
+using TreeSearch::MATE_BOUND;
+using TreeSearch::MATE_SCORE;
+using TreeSearch::MAX_PLY;
+using TreeSearch::TB_WIN_SCORE;
+
+// indexed by Pieces, used for move ordering only
+constexpr int32_t ordering_values[7] = {10'000, 900, 500, 330, 320, 100, 0};
+
+constexpr int32_t TT_MOVE_SCORE = 10'000'000;
+constexpr int32_t CAPTURE_SCORE = 1'000'000;
+constexpr int32_t PROMOTION_SCORE = 900'000;
+constexpr int32_t KILLER_SCORE[2] = {800'000, 700'000};
+// history scores converge towards this, far below the killers
+constexpr int32_t MAX_HISTORY = 16'384;
+static_assert(MAX_HISTORY < KILLER_SCORE[1]);
+// every depth below MAX_PLY survives the table, extensions are clamped
+static_assert(MAX_PLY - 1 <= TranspositionTable::MAX_DEPTH);
+
+struct SharedState {
+  const TreeSearch::SearchLimits &limits;
+  TranspositionTable &tt;
+  std::atomic<bool> &stop;
+  // only used by the main thread
+  TimeManager time_manager;
+  // 0 when no tables are loaded
+  int32_t tb_probe_limit;
+  // cleared by the caller on ponderhit, null if not pondering
+  const std::atomic<bool> *ponder;
+  // the main thread's view of ponder, the limits apply once it is false
+  bool pondering;
+};
+
+struct SearchThread {
+  SearchThread(const Board &board_, SharedState &shared_, int32_t id_,
+               std::span<const uint64_t> history)
+      : board(board_), shared(shared_), id(id_),
+        keys(history.begin(), history.end()), history_size(history.size()) {
+    keys.resize(history_size + MAX_PLY);
+  }
+
+  Board board;
+  SharedState &shared;
+  const int32_t id;
+
+  // the game history followed by the key of every ply on the current line
+  std::vector<uint64_t> keys;
+  const std::size_t history_size;
+
+  std::atomic<uint64_t> nodes{0};
+  int32_t sel_depth = 0;
+
+  std::array<SearchStack, MAX_PLY> stack;
+  int32_t history[2][64][64] = {};
+
+  Move pv[MAX_PLY][MAX_PLY];
+  int32_t pv_length[MAX_PLY] = {};
+
+  TreeSearch::SearchResult result;
+};
+
+uint64_t totalNodes(
+    const std::vector<std::unique_ptr<SearchThread>> &threads) {
+  uint64_t nodes = 0;
+  for (const auto &thread : threads) {
+    nodes += thread->nodes.load(std::memory_order_relaxed);
+  }
+  return nodes;
+}
+
+// main thread only, returns true while the search is still pondering
+inline bool checkPonder(SharedState &shared, uint64_t nodes) {
+  if (!shared.pondering) {
+    return false;
+  }
+  if (shared.ponder->load(std::memory_order_relaxed)) {
+    return true;
+  }
+
+  // ponderhit, our own clock starts now
+  shared.pondering = false;
+  shared.time_manager.restart(nodes);
+  return false;
+}
+
+inline void countNode(SearchThread &thread) {
+  const uint64_t nodes = thread.nodes.load(std::memory_order_relaxed) + 1;
+  thread.nodes.store(nodes, std::memory_order_relaxed);
+
+  // only the main thread polls the limits, helpers follow the stop flag
+  if (thread.id != 0) {
+    return;
+  }
+
+  SharedState &shared = thread.shared;
+  if (checkPonder(shared, nodes)) {
+    return;
+  }
+  if ((shared.limits.nodes && nodes >= shared.limits.nodes) ||
+      shared.time_manager.hardLimitReached(nodes)) {
+    shared.stop.store(true, std::memory_order_relaxed);
+  }
+}
+
+inline bool isCapture(const Board &board, const Move &move) {
+  // every diagonal pawn move is a capture, including en passant
+  return move.move_type == MoveType::REGULAR_PAWN_CAPTURE ||
+         board.isCellNotEmpty(move.pos_to, board.getPlayerTurn() ^ 1);
+}
+
+inline bool isPromotion(const Move &move) {
+  return move.move_type >= MoveType::PAWN_PROMOTE_QUEEN;
+}
+
+int32_t tablebaseScore(Tablebase::Wdl wdl, int32_t ply) {
+  switch (wdl) {
+  case Tablebase::Wdl::WIN:
+    return TB_WIN_SCORE - ply;
+  case Tablebase::Wdl::LOSS:
+    return -TB_WIN_SCORE + ply;
+  // drawn by the fifty-move rule, but prefer the side with winning chances
+  case Tablebase::Wdl::CURSED_WIN:
+    return 1;
+  case Tablebase::Wdl::BLESSED_LOSS:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+int32_t scoreToTT(int32_t score, int32_t ply) {
+  if (score > MATE_BOUND) {
+    return score + ply;
+  } else if (score < -MATE_BOUND) {
+    return score - ply;
+  }
+  return score;
+}
+
+int32_t scoreFromTT(int32_t score, int32_t ply) {
+  if (score > MATE_BOUND) {
+    return score - ply;
+  } else if (score < -MATE_BOUND) {
+    return score + ply;
+  }
+  return score;
+}
+
+void scoreMoves(SearchThread &thread, int32_t ply, const Move *tt_move) {
+  const Board &board = thread.board;
+  const bool turn = board.getPlayerTurn();
+  SearchStack &entry = thread.stack[ply];
+  std::vector<int32_t> &scores = entry.move_scores;
+
+  scores.clear();
+  for (const Move &move : entry.moves) {
+    int32_t score = 0;
+    if (tt_move && move == *tt_move) {
+      score = TT_MOVE_SCORE;
+    } else if (isCapture(board, move)) {
+      const SquareType victim = board.getPieceOnSquare(move.pos_to);
+      const int8_t victim_type = victim == SquareType::EMPTY
+                                     ? Pieces::PAWN
+                                     : int8_t(victim) >> 1;
+      score = CAPTURE_SCORE + ordering_values[victim_type] * 16 -
+              ordering_values[move.piece_type] / 16;
+      if (move.move_type == MoveType::PAWN_PROMOTE_QUEEN) {
+        score += ordering_values[Pieces::QUEEN];
       }
+    } else if (isPromotion(move)) {
+      score = move.move_type == MoveType::PAWN_PROMOTE_QUEEN ? PROMOTION_SCORE
+                                                             : -1;
+    } else if (move == entry.killers[0]) {
+      score = KILLER_SCORE[0];
+    } else if (move == entry.killers[1]) {
+      score = KILLER_SCORE[1];
+    } else {
+      score = thread.history[turn][std::countr_zero(move.pos_from)]
+                            [std::countr_zero(move.pos_to)];
+    }
+    scores.push_back(score);
+  }
+}
 
-      board.unmakeMove(undo_moves[cur_depth]);
+// moves the best remaining move to index, a lazy selection sort
+void pickMove(SearchThread &thread, int32_t ply, std::size_t index) {
+  std::vector<Move> &moves = thread.stack[ply].moves;
+  std::vector<int32_t> &scores = thread.stack[ply].move_scores;
 
-      continue;
+  std::size_t best = index;
+  for (std::size_t i = index + 1; i < moves.size(); i++) {
+    if (scores[i] > scores[best]) {
+      best = i;
+    }
+  }
+  std::swap(moves[index], moves[best]);
+  std::swap(scores[index], scores[best]);
+}
+
+void updatePv(SearchThread &thread, int32_t ply, const Move &move) {
+  thread.pv[ply][ply] = move;
+  for (int32_t i = ply + 1; i < thread.pv_length[ply + 1]; i++) {
+    thread.pv[ply][i] = thread.pv[ply + 1][i];
+  }
+  thread.pv_length[ply] = std::max(thread.pv_length[ply + 1], ply + 1);
+}
+
+int32_t quiesce(SearchThread &thread, int32_t ply, int32_t alpha,
+                int32_t beta) {
+  thread.pv_length[ply] = ply;
+  countNode(thread);
+  if (thread.shared.stop.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+  thread.sel_depth = std::max(thread.sel_depth, ply);
+
+  Board &board = thread.board;
+  const bool turn = board.getPlayerTurn();
+
+  SearchStack &entry = thread.stack[ply];
+  std::vector<Move> &moves = entry.moves;
+  moves.clear();
+  MoveExplorer::searchAllMoves(board, turn, moves);
+  if (moves.empty()) {
+    return board.isInCheck() ? -MATE_SCORE + ply : 0;
+  }
+  if (ply >= MAX_PLY - 1) {
+    return Evaluate::evaluateBoard(board);
+  }
+
+  // in check there is no quiet option to stand on, every evasion is searched
+  int32_t best_score = -MATE_SCORE + ply;
+  if (!board.isInCheck()) {
+    const int32_t stand_pat = Evaluate::evaluateBoard(board);
+    if (stand_pat >= beta) {
+      return stand_pat;
     }
+    alpha = std::max(alpha, stand_pat);
+    best_score = stand_pat;
 
-    const Move &move_to_make = new_moves[cur_depth][visited[cur_depth]];
-    visited[cur_depth] += 1;
+    std::erase_if(moves, [&board](const Move &move) {
+      return !isCapture(board, move) && !isPromotion(move);
+    });
+  }
+  scoreMoves(thread, ply, nullptr);
 
-    board.makeMove(move_to_make, undo_moves[cur_depth]);
-    if (cur_depth - 1 > 0) {
-      new_moves[cur_depth - 1].clear();
-      MoveExplorer::searchAllMoves(board, board.getPlayerTurn(),
-                                   new_moves[cur_depth - 1]);
-      visited[cur_depth - 1] = 0;
+  for (std::size_t i{0}; i < moves.size(); i++) {
+    pickMove(thread, ply, i);
+    const Move move = moves[i];
+
+    board.makeMove(move, entry.undo_move);
+    const int32_t score = -quiesce(thread, ply + 1, -beta, -alpha);
+    board.unmakeMove(entry.undo_move);
+
+    if (thread.shared.stop.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+
+    if (score > best_score) {
+      best_score = score;
+      if (score > alpha) {
+        alpha = score;
+        updatePv(thread, ply, move);
+        if (score >= beta) {
+          break;
+        }
+      }
     }
-    cur_depth--;
   }
 
-  return cnt;
+  return best_score;
+}
+
+int32_t negamax(SearchThread &thread, int32_t depth, int32_t ply,
+                int32_t alpha, int32_t beta) {
+  if (depth <= 0) {
+    return quiesce(thread, ply, alpha, beta);
+  }
+
+  thread.pv_length[ply] = ply;
+  countNode(thread);
+  if (thread.shared.stop.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+
+  thread.sel_depth = std::max(thread.sel_depth, ply);
+
+  Board &board = thread.board;
+  if (ply >= MAX_PLY - 1) {
+    return Evaluate::evaluateBoard(board);
+  }
+
+  // mate distance pruning, no line from here beats a shorter mate
+  if (ply > 0) {
+    alpha = std::max(alpha, -MATE_SCORE + ply);
+    beta = std::min(beta, MATE_SCORE - ply - 1);
+    if (alpha >= beta) {
+      return alpha;
+    }
+  }
+
+  // one repetition inside the tree is enough to call the line a draw
+  const uint64_t key = board.getHash();
+  if (ply > 0 && board.isRepetition(std::span(thread.keys.data(),
+                                              thread.history_size + ply))) {
+    return 0;
+  }
+  thread.keys[thread.history_size + ply] = key;
+
+  const bool turn = board.getPlayerTurn();
+  const bool is_pv = beta - alpha > 1;
+
+  TTEntry tt_entry;
+  const Move *tt_move = nullptr;
+  Stats::add(Stats::TT_PROBES);
+  if (thread.shared.tt.probe(key, tt_entry)) {
+    Stats::add(Stats::TT_HITS);
+    if (tt_entry.has_move) {
+      tt_move = &tt_entry.move;
+    }
+
+    const int32_t tt_score = scoreFromTT(tt_entry.score, ply);
+    if (!is_pv && tt_entry.depth >= depth &&
+        (tt_entry.bound == Bound::EXACT ||
+         (tt_entry.bound == Bound::LOWER && tt_score >= beta) ||
+         (tt_entry.bound == Bound::UPPER && tt_score <= alpha))) {
+      return tt_score;
+    }
+  }
+
+  const int32_t tb_probe_limit = thread.shared.tb_probe_limit;
+  Tablebase::Wdl wdl;
+  if (ply > 0 && tb_probe_limit &&
+      Tablebase::pieceCount(board) <= tb_probe_limit &&
+      Tablebase::probeWdl(board, wdl)) {
+    Stats::add(Stats::TB_HITS);
+    const int32_t score = tablebaseScore(wdl, ply);
+    thread.shared.tt.store(key, std::min(depth + 6, MAX_PLY - 1),
+                           scoreToTT(score, ply), Bound::EXACT, nullptr);
+    return score;
+  }
+
+  const bool in_check = board.isInCheck();
+  if (in_check) {
+    depth++;
+  }
+
+  SearchStack &entry = thread.stack[ply];
+  std::vector<Move> &moves = entry.moves;
+  moves.clear();
+  MoveExplorer::searchAllMoves(board, turn, moves);
+  if (moves.empty()) {
+    return in_check ? -MATE_SCORE + ply : 0;
+  }
+  // checked after mate, a mate on the hundredth half-move still counts
+  if (ply > 0 && board.getHalfmoveClock() >= 100) {
+    return 0;
+  }
+  scoreMoves(thread, ply, tt_move);
+
+  int32_t best_score = -INF_SCORE;
+  Move best_move = moves[0];
+  Bound bound = Bound::UPPER;
+
+  for (std::size_t i{0}; i < moves.size(); i++) {
+    pickMove(thread, ply, i);
+    const Move move = moves[i];
+    const bool is_quiet = !isCapture(board, move) && !isPromotion(move);
+
+    board.makeMove(move, entry.undo_move);
+
+    int32_t score;
+    if (i == 0) {
+      score = -negamax(thread, depth - 1, ply + 1, -beta, -alpha);
+    } else {
+      // principal variation search, prove the move is worse with a null window
+      score = -negamax(thread, depth - 1, ply + 1, -alpha - 1, -alpha);
+      if (score > alpha && score < beta) {
+        score = -negamax(thread, depth - 1, ply + 1, -beta, -alpha);
+      }
+    }
+    board.unmakeMove(entry.undo_move);
+
+    if (thread.shared.stop.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+
+    if (score > best_score) {
+      best_score = score;
+      best_move = move;
+
+      if (score > alpha) {
+        alpha = score;
+        bound = Bound::EXACT;
+        updatePv(thread, ply, move);
+
+        if (score >= beta) {
+          bound = Bound::LOWER;
+          Stats::addCutoff(i);
+          if (is_quiet) {
+            if (!(entry.killers[0] == move)) {
+              entry.killers[1] = entry.killers[0];
+              entry.killers[0] = move;
+            }
+            int32_t &history =
+                thread.history[turn][std::countr_zero(move.pos_from)]
+                              [std::countr_zero(move.pos_to)];
+            // the closer to MAX_HISTORY the less a cutoff adds, so long
+            // searches neither overflow nor outrank the killers
+            const int32_t bonus = std::min(depth * depth, MAX_HISTORY);
+            history += bonus - history * bonus / MAX_HISTORY;
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  thread.shared.tt.store(key, depth, scoreToTT(best_score, ply), bound,
+                         &best_move);
+  return best_score;
+}
+
+void iterativeDeepening(
+    SearchThread &thread,
+    const std::vector<std::unique_ptr<SearchThread>> &threads,
+    const TreeSearch::ReportCallback &report) {
+  SharedState &shared = thread.shared;
+  const bool is_main = thread.id == 0;
+  const int32_t max_depth = is_main ? shared.limits.depth : MAX_PLY - 1;
+
+  // odd helpers start one ply deeper so the threads desynchronise
+  for (int32_t depth = 1 + (thread.id & 1); depth <= max_depth; depth++) {
+    const Trace::Scope scope(is_main ? "iteration" : "helper iteration");
+    thread.sel_depth = 0;
+    const int32_t score = negamax(thread, depth, 0, -INF_SCORE, INF_SCORE);
+
+    if (shared.stop.load(std::memory_order_relaxed)) {
+      break;
+    }
+
+    thread.result.best_move = thread.pv[0][0];
+    thread.result.ponder_move =
+        thread.pv_length[0] > 1 ? thread.pv[0][1] : Move{};
+    thread.result.score = score;
+    thread.result.depth = depth;
+
+    if (is_main && report) {
+      report(TreeSearch::SearchReport{
+          depth, thread.sel_depth, score, totalNodes(threads),
+          shared.time_manager.elapsedMs(),
+          std::vector<Move>(thread.pv[0], thread.pv[0] + thread.pv_length[0])});
+    }
+
+    if (is_main) {
+      // a ponderhit is picked up first so the soft limit uses its clock
+      const bool pondering =
+          checkPonder(shared, thread.nodes.load(std::memory_order_relaxed));
+      if (shared.time_manager.softLimitReached(thread.result.best_move) &&
+          !pondering) {
+        break;
+      }
+    }
+  }
+}
+} // namespace
+
+TreeSearch::SearchResult
+TreeSearch::findBestMove(const Board &board, const SearchLimits &limits,
+                         TranspositionTable &tt, std::atomic<bool> &stop,
+                         int32_t threads_count, const ReportCallback &report,
+                         const std::atomic<bool> *ponder,
+                         std::span<const uint64_t> history) {
+  const Trace::Scope scope("findBestMove");
+  SharedState shared{
+      limits,
+      tt,
+      stop,
+      TimeManager{limits, board.getPlayerTurn()},
+      std::min(limits.syzygy_probe_limit, Tablebase::largest()),
+      ponder,
+      ponder && ponder->load(std::memory_order_relaxed)};
+
+  std::vector<std::unique_ptr<SearchThread>> threads;
+  for (int32_t i = 0; i < std::max(threads_count, 1); i++) {
+    threads.push_back(
+        std::make_unique<SearchThread>(board, shared, i, history));
+  }
+
+  std::vector<Move> root_moves;
+  root_moves.reserve(256);
+  MoveExplorer::searchAllMoves(threads[0]->board, board.getPlayerTurn(),
+                               root_moves);
+
+  std::vector<std::thread> helpers;
+  Move tb_move{};
+  Tablebase::Wdl wdl{};
+  if (!root_moves.empty() && shared.tb_probe_limit &&
+      Tablebase::pieceCount(board) <= shared.tb_probe_limit &&
+      Tablebase::probeRoot(board, tb_move, wdl)) {
+    // the tables already know the best move, there is nothing to search
+    SearchResult &tb_result = threads[0]->result;
+    tb_result.best_move = tb_move;
+    tb_result.score = tablebaseScore(wdl, 0);
+    tb_result.depth = 1;
+    if (report) {
+      report(SearchReport{1, 0, tb_result.score, 0,
+                          shared.time_manager.elapsedMs(), {tb_move}});
+    }
+  } else if (!root_moves.empty()) {
+    for (std::size_t i = 1; i < threads.size(); i++) {
+      helpers.emplace_back(iterativeDeepening, std::ref(*threads[i]),
+                           std::cref(threads), TreeSearch::ReportCallback{});
+    }
+
+    iterativeDeepening(*threads[0], threads, report);
+  }
+
+  // in infinite mode the best move may only be sent after a stop,
+  // a ponder search holds it until ponderhit or stop
+  while (((limits.infinite && !root_moves.empty()) ||
+          (ponder && ponder->load(std::memory_order_relaxed))) &&
+         !stop.load(std::memory_order_relaxed)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  stop.store(true, std::memory_order_relaxed);
+
+  for (auto &helper : helpers) {
+    helper.join();
+  }
+
+  SearchResult result = threads[0]->result;
+  // stopped before the first iteration completed
+  if (result.depth == 0 && !root_moves.empty()) {
+    result.best_move = root_moves[0];
+  }
+  result.nodes = totalNodes(threads);
+  return result;
 }
@@ -0,0 +1,305 @@
+#include "uci.hpp"
+#include "board.hpp"
+#include "book.hpp"
+#include "tablebase.hpp"
+#include "move.hpp"
+#include "transposition-table.hpp"
+#include "tree-search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int32_t MAX_HASH_MB = 65536;
+constexpr int32_t MAX_THREADS = 512;
+// the largest Syzygy tables published
+constexpr int32_t MAX_SYZYGY_PIECES = 7;
+
+struct EngineState {
+  Board board;
+  // keys of the game positions before board, oldest first
+  std::vector<uint64_t> key_history;
+  TranspositionTable tt;
+  int32_t threads = 1;
+  Book book;
+  Book::Selection book_selection = Book::Selection::WEIGHTED;
+  int32_t syzygy_probe_limit = MAX_SYZYGY_PIECES;
+
+  std::atomic<bool> stop{false};
+  // set while a go ponder search runs on the opponent's time
+  std::atomic<bool> ponder{false};
+  std::thread search_thread;
+};
+
+// the search thread and the input thread both write to stdout
+std::mutex output_mutex;
+
+void send(const std::string &line) {
+  std::lock_guard<std::mutex> lock(output_mutex);
+  std::cout << line << std::endl;
+}
+
+void stopSearch(EngineState &state) {
+  state.stop.store(true);
+  state.ponder.store(false);
+  if (state.search_thread.joinable()) {
+    state.search_thread.join();
+  }
+}
+
+std::string formatScore(int32_t score) {
+  if (score > TreeSearch::MATE_BOUND) {
+    return "mate " + std::to_string((TreeSearch::MATE_SCORE - score + 1) / 2);
+  } else if (score < -TreeSearch::MATE_BOUND) {
+    return "mate -" + std::to_string((TreeSearch::MATE_SCORE + score) / 2);
+  }
+  return "cp " + std::to_string(score);
+}
+
+void sendReport(const TreeSearch::SearchReport &report) {
+  const int64_t elapsed = std::max<int64_t>(report.elapsed_ms, 1);
+
+  std::ostringstream info;
+  info << "info depth " << report.depth << " seldepth " << report.sel_depth
+       << " score " << formatScore(report.score) << " nodes " << report.nodes
+       << " nps " << report.nodes * 1000 / elapsed << " time "
+       << report.elapsed_ms << " pv";
+  char formatted_move[Move::MAX_FORMATTED_LENGTH + 1];
+  for (const Move &move : report.pv) {
+    move.format(formatted_move);
+    info << " " << formatted_move;
+  }
+  send(info.str());
+}
+
+void handleUci() {
+  send("id name EloConqueror");
+  send("id author bsemerdzhiev");
+  send("option name Hash type spin default " +
+       std::to_string(TranspositionTable::DEFAULT_SIZE_MB) + " min 1 max " +
+       std::to_string(MAX_HASH_MB));
+  send("option name Threads type spin default 1 min 1 max " +
+       std::to_string(MAX_THREADS));
+  send("option name Ponder type check default false");
+  send("option name BookFile type string default <empty>");
+  send("option name BookBestMove type check default false");
+  send("option name SyzygyPath type string default <empty>");
+  send("option name SyzygyProbeLimit type spin default " +
+       std::to_string(MAX_SYZYGY_PIECES) + " min 0 max " +
+       std::to_string(MAX_SYZYGY_PIECES));
+  send("uciok");
+}
+
+void handleSetOption(EngineState &state, std::istringstream &tokens) {
+  std::string token;
+  std::string name;
+  std::string value;
+
+  tokens >> token; // name
+  while (tokens >> token && token != "value") {
+    name += name.empty() ? token : " " + token;
+  }
+  // file paths may contain spaces
+  std::getline(tokens >> std::ws, value);
+
+  try {
+    if (name == "Hash") {
+      const int32_t megabytes = std::clamp(std::stoi(value), 1, MAX_HASH_MB);
+      state.tt.resize(megabytes);
+    } else if (name == "Threads") {
+      state.threads = std::clamp(std::stoi(value), 1, MAX_THREADS);
+    } else if (name == "BookFile") {
+      if (value.empty() || value == "<empty>") {
+        state.book.close();
+      } else if (!state.book.open(value)) {
+        send("info string cannot open book " + value);
+      }
+    } else if (name == "SyzygyPath") {
+      const std::string path = value == "<empty>" ? "" : value;
+      if (!Tablebase::init(path)) {
+        send("info string no Syzygy tables loaded from " + path);
+      } else if (!path.empty()) {
+        send("info string Syzygy tables up to " +
+             std::to_string(Tablebase::largest()) + " pieces");
+      }
+    } else if (name == "SyzygyProbeLimit") {
+      state.syzygy_probe_limit =
+          std::clamp(std::stoi(value), 0, MAX_SYZYGY_PIECES);
+    } else if (name == "Ponder") {
+      // pondering is driven by go ponder, nothing to configure
+    } else if (name == "BookBestMove") {
+      state.book_selection = value == "true" ? Book::Selection::BEST
+                                             : Book::Selection::WEIGHTED;
+    } else {
+      send("info string unknown option " + name);
+    }
+  } catch (const std::exception &) {
+    send("info string invalid value " + value + " for option " + name);
+  }
+}
+
+void handlePosition(EngineState &state, std::istringstream &tokens) {
+  std::string token;
+  tokens >> token;
+
+  state.key_history.clear();
+  if (token == "startpos") {
+    state.board = Board{};
+    tokens >> token; // moves
+  } else if (token == "fen") {
+    std::string fen;
+    while (tokens >> token && token != "moves") {
+      fen += fen.empty() ? token : " " + token;
+    }
+    if (!state.board.setFen(fen)) {
+      send("info string invalid fen " + fen);
+      state.board = Board{};
+      return;
+    }
+  } else {
+    return;
+  }
+
+  while (tokens >> token) {
+    const uint64_t key = state.board.getHash();
+    if (!state.board.makeMove(token)) {
+      send("info string illegal move " + token);
+      break;
+    }
+    state.key_history.push_back(key);
+  }
+}
+
+void handlePerft(EngineState &state, int32_t depth) {
+  if (depth < 1) {
+    return;
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+  Board board = state.board;
+  const uint64_t nodes = TreeSearch::search(board, depth);
+  const int64_t elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+
+  send("info nodes " + std::to_string(nodes) + " time " +
+       std::to_string(elapsed) + " nps " +
+       std::to_string(nodes * 1000 / std::max<int64_t>(elapsed, 1)));
+}
+
+void handleGo(EngineState &state, std::istringstream &tokens) {
+  TreeSearch::SearchLimits limits;
+  limits.syzygy_probe_limit = state.syzygy_probe_limit;
+  bool ponder = false;
+  std::string token;
+
+  while (tokens >> token) {
+    if (token == "depth") {
+      tokens >> limits.depth;
+      limits.depth = std::clamp(limits.depth, 1, TreeSearch::MAX_PLY - 1);
+    } else if (token == "nodes") {
+      tokens >> limits.nodes;
+    } else if (token == "movetime") {
+      tokens >> limits.move_time;
+    } else if (token == "wtime") {
+      tokens >> limits.time_left[0];
+    } else if (token == "btime") {
+      tokens >> limits.time_left[1];
+    } else if (token == "winc") {
+      tokens >> limits.increment[0];
+    } else if (token == "binc") {
+      tokens >> limits.increment[1];
+    } else if (token == "movestogo") {
+      tokens >> limits.moves_to_go;
+    } else if (token == "infinite") {
+      limits.infinite = true;
+    } else if (token == "ponder") {
+      ponder = true;
+    } else if (token == "perft") {
+      int32_t depth = 0;
+      tokens >> depth;
+      handlePerft(state, depth);
+      return;
+    }
+  }
+
+  // analysis asks for a search, not for the book move, and a ponder
+  // search may not answer before ponderhit
+  Move book_move;
+  if (!limits.infinite && !ponder &&
+      state.book.probe(state.board, state.book_selection, book_move)) {
+    send("bestmove " + book_move.formatted());
+    return;
+  }
+
+  state.stop.store(false);
+  state.ponder.store(ponder);
+  state.search_thread = std::thread([&state, limits] {
+    const TreeSearch::SearchResult result =
+        TreeSearch::findBestMove(state.board, limits, state.tt, state.stop,
+                                 state.threads, sendReport, &state.ponder,
+                                 state.key_history);
+
+    std::string best_move = "bestmove ";
+    if (result.best_move.pos_from == 0) {
+      best_move += "0000";
+    } else {
+      best_move += result.best_move.formatted();
+      if (result.ponder_move.pos_from != 0) {
+        best_move += " ponder " + result.ponder_move.formatted();
+      }
+    }
+    send(best_move);
+  });
+}
+} // namespace
+
+void UCI::loop() {
+  EngineState state;
+  std::string line;
+
+  while (std::getline(std::cin, line)) {
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+
+    if (command == "uci") {
+      handleUci();
+    } else if (command == "isready") {
+      send("readyok");
+    } else if (command == "ucinewgame") {
+      stopSearch(state);
+      state.tt.clear();
+    } else if (command == "setoption") {
+      stopSearch(state);
+      handleSetOption(state, tokens);
+    } else if (command == "position") {
+      stopSearch(state);
+      handlePosition(state, tokens);
+    } else if (command == "go") {
+      stopSearch(state);
+      handleGo(state, tokens);
+    } else if (command == "ponderhit") {
+      // the running search continues as the real one
+      state.ponder.store(false);
+    } else if (command == "stop") {
+      stopSearch(state);
+    } else if (command == "d") {
+      std::lock_guard<std::mutex> lock(output_mutex);
+      state.board.displayBoard();
+    } else if (command == "quit") {
+      break;
+    }
+  }
+
+  stopSearch(state);
+}
@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+// kiwipete takes far longer than the positions around it
+constexpr const char *SLOW_POSITION =
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+constexpr const char *FAST_POSITION = "4k3/8/8/8/8/8/8/4K3 w - - 0 1";
+
+std::vector<std::string> readLines(const std::string &path) {
+  std::ifstream in(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+} // namespace
+
+TEST_CASE("EPD lines are cut down to the FEN fields") {
+  const std::string_view start =
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -";
+
+  // EPD operations follow the first four fields
+  CHECK(Batch::epdPosition(std::string(start) + " bm e4; id \"start\";") ==
+        start);
+  // perft suite annotations follow a semicolon
+  CHECK(Batch::epdPosition(std::string(start) + " 0 1 ;D1 20 ;D2 400") ==
+        std::string(start) + " 0 1");
+  CHECK(Batch::epdPosition(std::string(start) + " 3 7") ==
+        std::string(start) + " 3 7");
+  // a non-numeric fifth field is an operation, not a counter
+  CHECK(Batch::epdPosition(std::string(start) + " hmvc 0;") == start);
+}
+
+TEST_CASE("Malformed EPD lines are passed through for the FEN parser") {
+  CHECK(Batch::epdPosition("").empty());
+  CHECK(Batch::epdPosition("   ").empty());
+  CHECK(Batch::epdPosition(";D1 20").empty());
+  CHECK(Batch::epdPosition("garbage") == "garbage");
+  CHECK(Batch::epdPosition("8/8/8 w") == "8/8/8 w");
+  // more fields than a FEN has are dropped
+  CHECK(Batch::epdPosition("a b c d 1 2 3 4") == "a b c d 1 2");
+}
+
+TEST_CASE("Batch results come out in input order") {
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "eloconqueror-batch-test";
+  std::filesystem::create_directories(directory);
+
+  // the slow positions finish after the fast ones queued behind them
+  const std::vector<std::string> positions = {
+      SLOW_POSITION, FAST_POSITION, "not a fen",   FAST_POSITION,
+      SLOW_POSITION, FAST_POSITION, FAST_POSITION, "# a comment",
+      "",            FAST_POSITION, SLOW_POSITION, FAST_POSITION};
+  const std::string input_path = (directory / "input.epd").string();
+  {
+    std::ofstream input(input_path);
+    for (const std::string &position : positions) {
+      input << position << '\n';
+    }
+  }
+
+  Batch::Options options;
+  options.input_path = input_path;
+  options.output_path = (directory / "output.csv").string();
+  options.mode = Batch::Mode::PERFT;
+  options.depth = 3;
+  options.threads = 3;
+  // smaller than the input, so result slots are reused
+  options.window = 4;
+  REQUIRE(Batch::run(options) == 0);
+
+  const std::vector<std::string> rows = readLines(options.output_path);
+  const std::string slow = "\"" + std::string(SLOW_POSITION) + "\",97862,";
+  const std::string fast = "\"" + std::string(FAST_POSITION) + "\",";
+  const std::vector<std::string> expected_starts = {
+      "0," + slow, "1," + fast, "2,\"not a fen\",,invalid fen",
+      "3," + fast, "4," + slow, "5," + fast,
+      "6," + fast, "7," + fast, "8," + slow,
+      "9," + fast};
+
+  REQUIRE(rows.size() == expected_starts.size() + 1);
+  CHECK(rows[0] == "index,fen,nodes,error");
+  for (std::size_t i = 0; i < expected_starts.size(); i++) {
+    CHECK(rows[i + 1].starts_with(expected_starts[i]));
+    // every row has the header's four columns, the FENs hold no commas
+    CHECK(std::ranges::count(rows[i + 1], ',') == 3);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Search error rows keep every CSV column") {
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "eloconqueror-batch-csv-test";
+  std::filesystem::create_directories(directory);
+  const std::string input_path = (directory / "input.epd").string();
+  {
+    std::ofstream input(input_path);
+    input << FAST_POSITION << "\nnot a fen\n";
+  }
+
+  Batch::Options options;
+  options.input_path = input_path;
+  options.output_path = (directory / "output.csv").string();
+  options.mode = Batch::Mode::SEARCH;
+  options.depth = 1;
+  options.hash_mb = 1;
+  REQUIRE(Batch::run(options) == 0);
+
+  const std::vector<std::string> rows = readLines(options.output_path);
+  REQUIRE(rows.size() == 3);
+  CHECK(rows[0] == "index,fen,bestmove,score,depth,nodes,error");
+  CHECK(rows[1].ends_with(","));
+  CHECK(rows[2] == "1,\"not a fen\",,,,,invalid fen");
+  for (const std::string &row : rows) {
+    CHECK(std::ranges::count(row, ',') == 6);
+  }
+
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,202 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "board.hpp"
+#include "move.hpp"
+#include "undo_move.hpp"
+#include "util.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("Move strings are formatted in UCI notation") {
+  const Move quiet{Board::getPositionAsBitboard(1, 4),
+                   Board::getPositionAsBitboard(3, 4), Pieces::PAWN,
+                   MoveType::PAWN_MOVE_TWO_SQUARES};
+  CHECK(quiet.formatted() == "e2e4");
+
+  const Move promotion{Board::getPositionAsBitboard(6, 0),
+                       Board::getPositionAsBitboard(7, 1), Pieces::PAWN,
+                       MoveType::PAWN_PROMOTE_KNIGHT};
+  CHECK(promotion.formatted() == "a7b8n");
+}
+
+TEST_CASE("Parses UCI move strings") {
+  Board board;
+  CHECK(board.makeMove("e2e4"));
+  CHECK(board.makeMove("e7e5"));
+  CHECK(board.makeMove("g1f3"));
+  CHECK(board.getPlayerTurn() == 1);
+
+  // wrong side, blocked, malformed and out of range moves
+  CHECK_FALSE(board.makeMove("d2d4"));
+  CHECK_FALSE(board.makeMove("d8d6"));
+  CHECK_FALSE(board.makeMove("e7"));
+  CHECK_FALSE(board.makeMove("e5e4q"));
+  CHECK_FALSE(board.makeMove("i7i5"));
+  CHECK(board.getPlayerTurn() == 1);
+}
+
+TEST_CASE("Parses castling, en passant and promotions") {
+  Board castling{
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"};
+  CHECK(castling.makeMove("e1g1"));
+  CHECK(castling.makeMove("e8c8"));
+  CHECK(castling.getPiece(Pieces::ROOK, 0) &
+        Board::getPositionAsBitboard(0, 5));
+  CHECK(castling.getPiece(Pieces::ROOK, 1) &
+        Board::getPositionAsBitboard(7, 3));
+
+  Board en_passant{"8/8/8/3pP3/8/8/8/4K2k w - d6 0 1"};
+  CHECK(en_passant.makeMove("e5d6"));
+  CHECK(en_passant.getPiece(Pieces::PAWN, 1) == 0);
+
+  Board promotion{"8/P7/8/8/8/8/8/4K2k w - - 0 1"};
+  CHECK_FALSE(promotion.makeMove("a7a8"));
+  CHECK(promotion.makeMove("a7a8r"));
+  CHECK(promotion.getPiece(Pieces::ROOK, 0) ==
+        Board::getPositionAsBitboard(7, 0));
+}
+
+TEST_CASE("FEN round trip") {
+  const char *fens[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 3",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 99 150",
+  };
+
+  for (const char *fen : fens) {
+    Board board;
+    REQUIRE(board.setFen(fen));
+
+    char out[Board::MAX_FEN_LENGTH];
+    const std::size_t length = board.toFen(out);
+    CHECK(std::string(out, length) == fen);
+  }
+
+  CHECK(Board{}.getHash() ==
+        Board{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"}
+            .getHash());
+}
+
+TEST_CASE("FEN move counters") {
+  Board board{"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 12 40"};
+  CHECK(board.getHalfmoveClock() == 12);
+  CHECK(board.getFullmoveNumber() == 40);
+
+  // EPD style, no counters
+  Board epd{"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -"};
+  CHECK(epd.getHalfmoveClock() == 0);
+  CHECK(epd.getFullmoveNumber() == 1);
+}
+
+TEST_CASE("Move counters follow make and unmake") {
+  Board board{"r3k2r/8/8/8/8/8/4P3/R3K2R w KQkq - 7 20"};
+
+  REQUIRE(board.makeMove("a1b1"));
+  CHECK(board.getHalfmoveClock() == 8);
+  CHECK(board.getFullmoveNumber() == 20);
+
+  REQUIRE(board.makeMove("e8g8"));
+  CHECK(board.getHalfmoveClock() == 9);
+  CHECK(board.getFullmoveNumber() == 21);
+
+  Move pawn_push;
+  REQUIRE(board.parseMove("e2e4", pawn_push));
+  UndoMove undo_move;
+  board.makeMove(pawn_push, undo_move);
+  CHECK(board.getHalfmoveClock() == 0);
+
+  board.unmakeMove(undo_move);
+  CHECK(board.getHalfmoveClock() == 9);
+  CHECK(board.getFullmoveNumber() == 21);
+
+  REQUIRE(board.makeMove("b1b8"));
+  CHECK(board.getHalfmoveClock() == 10);
+  REQUIRE(board.makeMove("a8b8"));
+  CHECK(board.getHalfmoveClock() == 0);
+}
+
+TEST_CASE("Repetitions since the last irreversible move") {
+  // the board keeps no history, the game records the key before each move
+  std::vector<uint64_t> keys;
+  auto play = [&keys](Board &board, const char *move) {
+    keys.push_back(board.getHash());
+    return board.makeMove(move);
+  };
+
+  Board board;
+  for (const char *move : {"g1f3", "g8f6", "f3g1"}) {
+    REQUIRE(play(board, move));
+    CHECK_FALSE(board.isRepetition(keys));
+  }
+  REQUIRE(play(board, "f6g8"));
+  CHECK(board.isRepetition(keys));
+
+  // the scan starts over after a pawn move
+  REQUIRE(play(board, "e2e3"));
+  for (const char *move : {"g8f6", "g1f3", "f6g8"}) {
+    REQUIRE(play(board, move));
+    CHECK_FALSE(board.isRepetition(keys));
+  }
+  REQUIRE(play(board, "f3g1"));
+  CHECK(board.isRepetition(keys));
+  CHECK(board.getHalfmoveClock() == 4);
+
+  // a FEN's halfmove clock does not reach back past the given keys
+  const Board reset{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 4 3"};
+  CHECK_FALSE(reset.isRepetition({}));
+}
+
+TEST_CASE("Checkers follow make and unmake") {
+  Board board("4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1");
+  CHECK(board.getCheckers() == 0);
+
+  // knight check with a discovered rook check behind it
+  Move move;
+  REQUIRE(board.parseMove("e4d6", move));
+  UndoMove undo_move;
+  board.makeMove(move, undo_move);
+  CHECK(board.getCheckers() == (Board::chessSquareAsPosition("d6") |
+                                Board::chessSquareAsPosition("e1")));
+  CHECK(board.isInCheck());
+
+  board.unmakeMove(undo_move);
+  CHECK_FALSE(board.isInCheck());
+
+  REQUIRE(board.setFen("4k3/8/8/8/8/8/8/4R1K1 b - - 0 1"));
+  CHECK(board.getCheckers() == Board::chessSquareAsPosition("e1"));
+}
+
+TEST_CASE("Malformed FENs are rejected") {
+  const char *fens[] = {
+      "",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",
+      "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNRR w KQkq - 0 1",
+      "rnbqkbnr/ppppxppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "rnbqqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 extra",
+  };
+
+  for (const char *fen : fens) {
+    Board board;
+    CHECK_FALSE(board.setFen(fen));
+  }
+
+  CHECK_THROWS_AS(Board{"not a fen"}, std::invalid_argument);
+}
+
+TEST_CASE("FEN castling rights follow the pieces") {
+  // the h1 rook is missing, so white can only castle long
+  Board board{"r3k2r/8/8/8/8/8/8/R3K3 w KQkq - 0 1"};
+  CHECK_FALSE(board.checkCastlingRights(0, 1));
+  CHECK(board.checkCastlingRights(0, 0));
+  CHECK(board.checkCastlingRights(1, 1));
+}
@@ -0,0 +1,141 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "board.hpp"
+#include "book.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+void writeBigEndian(std::ofstream &out, uint64_t value, int32_t bytes) {
+  for (int32_t i = bytes - 1; i >= 0; i--) {
+    out.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+  }
+}
+
+struct BookEntry {
+  uint64_t key;
+  uint16_t move;
+  uint16_t weight;
+};
+
+uint16_t polyglotMove(std::string_view from, std::string_view to) {
+  const int32_t from_sq = (from[1] - '1') * 8 + (from[0] - 'a');
+  const int32_t to_sq = (to[1] - '1') * 8 + (to[0] - 'a');
+  return static_cast<uint16_t>(from_sq << 6 | to_sq);
+}
+
+std::string writeBook(const std::filesystem::path &directory,
+                      std::vector<BookEntry> entries) {
+  std::sort(entries.begin(), entries.end(),
+            [](const BookEntry &a, const BookEntry &b) {
+              return a.key < b.key;
+            });
+
+  const std::string path = (directory / "book.bin").string();
+  std::ofstream out(path, std::ios::binary);
+  for (const BookEntry &entry : entries) {
+    writeBigEndian(out, entry.key, 8);
+    writeBigEndian(out, entry.move, 2);
+    writeBigEndian(out, entry.weight, 2);
+    writeBigEndian(out, 0, 4);
+  }
+  return path;
+}
+} // namespace
+
+TEST_CASE("Polyglot keys match the specification", "[book]") {
+  struct KeyExample {
+    std::vector<std::string> moves;
+    uint64_t key;
+  };
+  // the examples published with the Polyglot book format
+  const std::vector<KeyExample> examples = {
+      {{}, Book::START_POSITION_KEY},
+      {{"e2e4"}, 0x823C9B50FD114196ULL},
+      {{"e2e4", "d7d5"}, 0x0756B94461C50FB0ULL},
+      {{"e2e4", "d7d5", "e4e5"}, 0x662FAFB965DB29D4ULL},
+      {{"e2e4", "d7d5", "e4e5", "f7f5"}, 0x22A48B5A8E47FF78ULL},
+      {{"e2e4", "d7d5", "e4e5", "f7f5", "e1e2"}, 0x652A607CA3F242C1ULL},
+      {{"e2e4", "d7d5", "e4e5", "f7f5", "e1e2", "e8f7"},
+       0x00FDD303C946BDD9ULL},
+      {{"a2a4", "b7b5", "h2h4", "b5b4", "c2c4"}, 0x3C8123EA7B067637ULL},
+      {{"a2a4", "b7b5", "h2h4", "b5b4", "c2c4", "b4c3", "a1a3"},
+       0x5C3F9B829B279560ULL},
+  };
+
+  for (const KeyExample &example : examples) {
+    Board board;
+    for (const std::string &move : example.moves) {
+      REQUIRE(board.makeMove(move));
+    }
+    CHECK(Book::polyglotKey(board) == example.key);
+  }
+}
+
+TEST_CASE("Polyglot book probing", "[book]") {
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "eloconqueror-book-test";
+  std::filesystem::create_directories(directory);
+
+  Book book;
+  REQUIRE_FALSE(book.isReady());
+
+  const Board castling{"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1"};
+  const Board after_e4{
+      "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"};
+  const Board after_e4_no_ep{
+      "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1"};
+  // no black pawn can take on e3, so the en passant file is ignored
+  REQUIRE(Book::polyglotKey(after_e4) == Book::polyglotKey(after_e4_no_ep));
+  const Board after_d4{
+      "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq - 0 1"};
+
+  REQUIRE(book.open(writeBook(
+      directory,
+      {
+          {Book::START_POSITION_KEY, polyglotMove("d2", "d4"), 5},
+          {Book::START_POSITION_KEY, polyglotMove("e2", "e4"), 10},
+          // the published key of the position after 1. e4
+          {0x823C9B50FD114196ULL, polyglotMove("c7", "c5"), 1},
+          {Book::polyglotKey(castling), polyglotMove("e1", "h1"), 1},
+          // illegal in the position, must not be played
+          {Book::polyglotKey(after_d4), polyglotMove("e2", "e4"), 1},
+      })));
+  REQUIRE(book.isReady());
+
+  Move move;
+  SECTION("Best move picks the highest weight") {
+    REQUIRE(book.probe(Board{}, Book::Selection::BEST, move));
+    REQUIRE(move.formatted() == "e2e4");
+  }
+
+  SECTION("Replies are found under the published keys") {
+    REQUIRE(book.probe(after_e4, Book::Selection::BEST, move));
+    REQUIRE(move.formatted() == "c7c5");
+  }
+
+  SECTION("Weighted selection only returns book moves") {
+    for (int32_t i = 0; i < 32; i++) {
+      REQUIRE(book.probe(Board{}, Book::Selection::WEIGHTED, move));
+      REQUIRE((move.formatted() == "e2e4" || move.formatted() == "d2d4"));
+    }
+  }
+
+  SECTION("Castling is translated from king takes rook") {
+    REQUIRE(book.probe(castling, Book::Selection::BEST, move));
+    REQUIRE(move.formatted() == "e1g1");
+  }
+
+  SECTION("Illegal and missing entries are not played") {
+    REQUIRE_FALSE(book.probe(after_d4, Book::Selection::BEST, move));
+    REQUIRE_FALSE(book.probe(Board{"4k3/8/8/8/8/8/8/4K3 w - - 0 1"},
+                             Book::Selection::BEST, move));
+  }
+
+  book.close();
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "engine.hpp"
+#include "tree-search.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace {
+// a depth no analysis reaches before it is cancelled
+TreeSearch::SearchLimits deepLimits() {
+  TreeSearch::SearchLimits limits;
+  limits.depth = TreeSearch::MAX_PLY - 1;
+  return limits;
+}
+} // namespace
+
+TEST_CASE("Sessions analyse independent positions concurrently") {
+  Engine engine(2);
+
+  const std::shared_ptr<Session> rook_mate = engine.createSession(1);
+  REQUIRE(rook_mate->setPosition("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"));
+  const std::shared_ptr<Session> scholars_mate = engine.createSession(1);
+  REQUIRE(scholars_mate->setPosition(
+      "rnbqkbnr/pppp1ppp/8/4p3/2B1P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 2",
+      {"b8c6", "d1h5", "g8f6"}));
+
+  TreeSearch::SearchLimits limits;
+  limits.depth = 3;
+  std::future<TreeSearch::SearchResult> first = rook_mate->analyze(limits);
+  std::future<TreeSearch::SearchResult> second =
+      scholars_mate->analyze(limits);
+
+  // the position can change while the analyses are queued
+  REQUIRE(rook_mate->setPosition("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"));
+
+  CHECK(first.get().best_move.formatted() == "a1a8");
+  CHECK(second.get().best_move.formatted() == "h5f7");
+  CHECK(rook_mate->analyze(limits).get().best_move.pos_from == 0);
+}
+
+TEST_CASE("Session positions are validated") {
+  Engine engine(1);
+  const std::shared_ptr<Session> session = engine.createSession(1);
+
+  const std::string start = session->getFen();
+  CHECK_FALSE(session->setPosition("not a fen"));
+  CHECK_FALSE(session->setPosition(start, {"e2e5"}));
+  CHECK(session->getFen() == start);
+
+  REQUIRE(session->setPosition(start, {"e2e4"}));
+  CHECK(session->getFen() ==
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+}
+
+TEST_CASE("Cancelled analyses still return a move") {
+  Engine engine(1);
+  const std::shared_ptr<Session> session = engine.createSession(1);
+
+  TreeSearch::SearchLimits limits;
+  limits.infinite = true;
+  std::future<TreeSearch::SearchResult> running = session->analyze(limits);
+  // queued behind the running one on the single worker
+  std::future<TreeSearch::SearchResult> queued = session->analyze(limits);
+
+  CHECK(running.wait_for(std::chrono::milliseconds(50)) ==
+        std::future_status::timeout);
+  session->cancel();
+
+  CHECK(running.get().best_move.pos_from != 0);
+  CHECK(queued.get().best_move.pos_from != 0);
+}
+
+TEST_CASE("Cancelling stops an analysis that is already searching") {
+  Engine engine(1);
+  const std::shared_ptr<Session> session = engine.createSession();
+
+  // resolved from the worker once the first iteration is done
+  std::promise<void> started;
+  bool reported = false;
+  std::future<TreeSearch::SearchResult> running = session->analyze(
+      deepLimits(), [&started, &reported](const TreeSearch::SearchReport &) {
+        if (!reported) {
+          reported = true;
+          started.set_value();
+        }
+      });
+
+  REQUIRE(started.get_future().wait_for(std::chrono::seconds(10)) ==
+          std::future_status::ready);
+  session->cancel();
+
+  REQUIRE(running.wait_for(std::chrono::seconds(10)) ==
+          std::future_status::ready);
+  const TreeSearch::SearchResult result = running.get();
+  CHECK(result.best_move.pos_from != 0);
+  CHECK(result.depth < TreeSearch::MAX_PLY - 1);
+}
+
+TEST_CASE("Destroying the engine fulfils queued analyses") {
+  std::vector<std::future<TreeSearch::SearchResult>> results;
+  {
+    Engine engine(1);
+    for (int32_t i = 0; i < 3; i++) {
+      const std::shared_ptr<Session> session = engine.createSession();
+      // two per session, all but one wait in the queue
+      results.push_back(session->analyze(deepLimits()));
+      results.push_back(session->analyze(deepLimits()));
+    }
+  }
+
+  for (std::future<TreeSearch::SearchResult> &result : results) {
+    REQUIRE(result.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready);
+    CHECK(result.get().best_move.pos_from != 0);
+  }
+}
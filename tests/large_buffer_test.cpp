@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "large-buffer.hpp"
+#include "transposition-table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+bool isAligned(const void *data) {
+  return reinterpret_cast<uintptr_t>(data) % LargeBuffer::HUGE_PAGE_SIZE ==
+         0;
+}
+
+bool isZero(const LargeBuffer &buffer) {
+  const char *bytes = static_cast<const char *>(buffer.data());
+  return std::all_of(bytes, bytes + buffer.size(),
+                     [](char byte) { return byte == 0; });
+}
+} // namespace
+
+TEST_CASE("Large buffers are rounded up to aligned huge pages") {
+  const LargeBuffer empty;
+  CHECK(empty.data() == nullptr);
+  CHECK(empty.size() == 0);
+
+  const LargeBuffer small{1};
+  CHECK(isAligned(small.data()));
+  CHECK(small.size() == LargeBuffer::HUGE_PAGE_SIZE);
+
+  const LargeBuffer uneven{LargeBuffer::HUGE_PAGE_SIZE + 1};
+  CHECK(isAligned(uneven.data()));
+  CHECK(uneven.size() == 2 * LargeBuffer::HUGE_PAGE_SIZE);
+}
+
+TEST_CASE("Large buffers are zeroed in parallel chunks") {
+  // big enough that zero() splits the work over three threads
+  LargeBuffer buffer{96 << 20};
+  std::memset(buffer.data(), 0xAB, buffer.size());
+
+  buffer.zero(3);
+  CHECK(isZero(buffer));
+
+  std::memset(buffer.data(), 0xCD, buffer.size());
+  buffer.zero();
+  CHECK(isZero(buffer));
+}
+
+TEST_CASE("Large buffers move ownership") {
+  LargeBuffer first{1};
+  void *const data = first.data();
+  const std::size_t size = first.size();
+
+  LargeBuffer second{std::move(first)};
+  CHECK(second.data() == data);
+  CHECK(second.size() == size);
+  CHECK(first.data() == nullptr);
+  CHECK(first.size() == 0);
+
+  LargeBuffer third{3 * LargeBuffer::HUGE_PAGE_SIZE};
+  third = std::move(second);
+  CHECK(third.data() == data);
+  CHECK(third.size() == size);
+  CHECK(second.data() == nullptr);
+  CHECK(second.size() == 0);
+
+  // the moved-from buffer is empty but still usable
+  second = LargeBuffer{1};
+  CHECK(isAligned(second.data()));
+}
+
+TEST_CASE("A failed resize keeps the transposition table") {
+  TranspositionTable tt;
+  tt.resize(1);
+  tt.store(0x1234, 3, 42, Bound::EXACT, nullptr);
+
+  // a petabyte is more address space than any machine hands out
+  CHECK_THROWS_AS(tt.resize(std::size_t{1} << 30), std::bad_alloc);
+
+  TTEntry entry;
+  REQUIRE(tt.probe(0x1234, entry));
+  CHECK(entry.score == 42);
+  CHECK(entry.depth == 3);
+}
@@ -39,3 +39,10 @@ TEST_CASE("Position 6") {
               "- - 0 10"};
   CHECK(TreeSearch::search(board, 4) == 3'894'594);
 }
+
+TEST_CASE("Copy-make perft matches make/unmake") {
+  Board board{
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"};
+  CHECK(TreeSearch::searchCopyMake(board, 3) == 97'862);
+  CHECK(TreeSearch::searchCopyMake(board, 0) == 1);
+}
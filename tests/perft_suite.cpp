@@ -0,0 +1,275 @@
+#include "board.hpp"
+#include "tree-search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Verifies perft counts from a perftsuite.epd style file, e.g.
+ * rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400
+ *
+ * usage: perft-suite <file.epd> [--threads N] [--max-depth D]
+ *                    [--budget-ms T] [--copy-make]
+ *
+ * Positions are spread over the threads. Within a position the depths
+ * are checked in increasing order, and a depth is skipped once its
+ * estimated time would exceed the per-position budget.
+ * --copy-make runs perft with a board copy per ply instead of
+ * make/unmake, so both can be timed on the same suite.
+ */
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Expectation {
+  int32_t depth;
+  uint64_t nodes;
+};
+
+struct SuitePosition {
+  std::size_t line_number;
+  std::string fen;
+  std::vector<Expectation> expectations;
+
+  // filled in by the workers
+  bool valid_fen = true;
+  int32_t verified_depth = 0;
+  int32_t skipped_depths = 0;
+  const Expectation *failed = nullptr;
+  uint64_t failed_nodes = 0;
+  uint64_t nodes = 0;
+  int64_t elapsed_us = 0;
+};
+
+struct SuiteOptions {
+  std::string path;
+  int32_t threads = std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+  int32_t max_depth = TreeSearch::MAX_PLY - 1;
+  int64_t budget_ms = 0; // 0 means no budget
+  bool copy_make = false;
+};
+
+template <typename T> bool parseNumber(std::string_view text, T &value) {
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+// parses ";D1 20 ;D2 400" annotations, returns false if malformed
+bool parseExpectations(std::string_view annotations,
+                       std::vector<Expectation> &expectations) {
+  while (!annotations.empty()) {
+    const std::size_t end = std::min(annotations.find(';'), annotations.size());
+    std::string_view annotation = annotations.substr(0, end);
+    annotations.remove_prefix(std::min(end + 1, annotations.size()));
+
+    annotation.remove_prefix(
+        std::min(annotation.find_first_not_of(' '), annotation.size()));
+    annotation = annotation.substr(0, annotation.find_last_not_of(' ') + 1);
+    if (annotation.empty()) {
+      continue;
+    }
+
+    const std::size_t space = annotation.find(' ');
+    Expectation expectation;
+    if (annotation[0] != 'D' || space == std::string_view::npos ||
+        !parseNumber(annotation.substr(1, space - 1), expectation.depth) ||
+        !parseNumber(annotation.substr(space + 1), expectation.nodes) ||
+        expectation.depth < 1) {
+      return false;
+    }
+    expectations.push_back(expectation);
+  }
+
+  std::sort(expectations.begin(), expectations.end(),
+            [](const Expectation &a, const Expectation &b) {
+              return a.depth < b.depth;
+            });
+  return true;
+}
+
+void verifyPosition(SuitePosition &position, const SuiteOptions &options) {
+  Board board;
+  if (!board.setFen(position.fen)) {
+    position.valid_fen = false;
+    return;
+  }
+
+  const auto start_time = Clock::now();
+  int64_t last_depth_us = 0;
+  uint64_t last_depth_nodes = 0;
+
+  for (const Expectation &expectation : position.expectations) {
+    if (expectation.depth > options.max_depth) {
+      position.skipped_depths++;
+      continue;
+    }
+
+    // the next depth costs about as much more as it has more nodes
+    if (options.budget_ms && last_depth_nodes) {
+      const int64_t estimate_us =
+          last_depth_us * int64_t(expectation.nodes / last_depth_nodes);
+      if (position.elapsed_us + estimate_us > options.budget_ms * 1000) {
+        position.skipped_depths++;
+        continue;
+      }
+    }
+
+    const auto depth_start = Clock::now();
+    const uint64_t nodes =
+        options.copy_make
+            ? TreeSearch::searchCopyMake(board, expectation.depth)
+            : TreeSearch::search(board, expectation.depth);
+    last_depth_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - depth_start)
+                        .count();
+    last_depth_nodes = std::max<uint64_t>(nodes, 1);
+
+    position.nodes += nodes;
+    position.elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                              start_time)
+            .count();
+
+    if (nodes != expectation.nodes) {
+      position.failed = &expectation;
+      position.failed_nodes = nodes;
+      return;
+    }
+    position.verified_depth = expectation.depth;
+  }
+}
+
+bool parseOptions(int argc, char **argv, SuiteOptions &options) {
+  for (int32_t i = 1; i < argc; i++) {
+    const std::string_view argument = argv[i];
+    const std::string_view value = i + 1 < argc ? argv[i + 1] : "";
+
+    if (argument == "--copy-make") {
+      options.copy_make = true;
+      continue;
+    } else if (argument == "--threads" &&
+               parseNumber(value, options.threads)) {
+      options.threads = std::max(options.threads, 1);
+    } else if (argument == "--max-depth" &&
+               parseNumber(value, options.max_depth)) {
+    } else if (argument == "--budget-ms" &&
+               parseNumber(value, options.budget_ms)) {
+    } else if (!argument.starts_with("--") && options.path.empty()) {
+      options.path = argument;
+      continue;
+    } else {
+      return false;
+    }
+    i++; // skip the value
+  }
+  return !options.path.empty();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  SuiteOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: perft-suite <file.epd> [--threads N] "
+                 "[--max-depth D] [--budget-ms T] [--copy-make]\n";
+    return 1;
+  }
+
+  std::ifstream input(options.path);
+  if (!input) {
+    std::cerr << "cannot open " << options.path << "\n";
+    return 1;
+  }
+
+  std::vector<SuitePosition> positions;
+  std::string line;
+  for (std::size_t line_number = 1; std::getline(input, line);
+       line_number++) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    const std::size_t annotations_start = std::min(line.find(';'), line.size());
+    std::string fen = line.substr(0, annotations_start);
+    fen.erase(fen.find_last_not_of(' ') + 1);
+
+    SuitePosition position{line_number, std::move(fen), {}};
+    if (!parseExpectations(std::string_view(line).substr(annotations_start),
+                           position.expectations)) {
+      std::cerr << "line " << line_number << ": malformed annotations\n";
+      return 1;
+    }
+    positions.push_back(std::move(position));
+  }
+
+  const auto start_time = Clock::now();
+  std::atomic<std::size_t> next_position{0};
+
+  std::vector<std::thread> workers;
+  for (int32_t i = 0; i < options.threads; i++) {
+    workers.emplace_back([&positions, &options, &next_position] {
+      for (std::size_t index = next_position++; index < positions.size();
+           index = next_position++) {
+        verifyPosition(positions[index], options);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  const int64_t wall_us = std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            start_time)
+          .count(),
+      1);
+
+  uint64_t total_nodes = 0;
+  int64_t total_position_us = 0;
+  int32_t failures = 0;
+
+  for (const SuitePosition &position : positions) {
+    total_nodes += position.nodes;
+    total_position_us += position.elapsed_us;
+
+    std::cout << "line " << position.line_number << ": ";
+    if (!position.valid_fen) {
+      failures++;
+      std::cout << "FAIL invalid fen";
+    } else if (position.failed) {
+      failures++;
+      std::cout << "FAIL D" << position.failed->depth << " expected "
+                << position.failed->nodes << " got " << position.failed_nodes;
+    } else {
+      std::cout << "OK D" << position.verified_depth;
+      if (position.skipped_depths) {
+        std::cout << " (" << position.skipped_depths << " skipped)";
+      }
+    }
+    std::cout << " nodes " << position.nodes << " nps "
+              << position.nodes * 1'000'000 /
+                     std::max<int64_t>(position.elapsed_us, 1)
+              << " " << position.fen << "\n";
+  }
+
+  std::cout << "\n"
+            << positions.size() << " positions, " << failures
+            << " failed, nodes " << total_nodes << ", time "
+            << wall_us / 1000 << " ms\n"
+            << "aggregate nps " << total_nodes * 1'000'000 / wall_us
+            << ", per thread nps "
+            << total_nodes * 1'000'000 /
+                   std::max<int64_t>(total_position_us, 1)
+            << "\n";
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "board.hpp"
+#include "search.hpp"
+#include "time-manager.hpp"
+#include "transposition-table.hpp"
+#include "tree-search.hpp"
+#include "undo_move.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+namespace {
+TreeSearch::SearchResult searchToDepth(const Board &board, int32_t depth,
+                                       int32_t threads = 1) {
+  TranspositionTable tt;
+  std::atomic<bool> stop{false};
+  TreeSearch::SearchLimits limits;
+  limits.depth = depth;
+  return TreeSearch::findBestMove(board, limits, tt, stop, threads);
+}
+
+// walks the tree and checks the incremental key against a full recompute
+bool hashIsConsistent(Board &board, int32_t depth) {
+  if (board.getHash() != board.computeHash()) {
+    return false;
+  }
+  if (depth == 0) {
+    return true;
+  }
+
+  std::vector<Move> moves;
+  MoveExplorer::searchAllMoves(board, board.getPlayerTurn(), moves);
+  for (const Move &move : moves) {
+    UndoMove undo_move;
+    board.makeMove(move, undo_move);
+    const bool consistent = hashIsConsistent(board, depth - 1);
+    board.unmakeMove(undo_move);
+    if (!consistent) {
+      return false;
+    }
+  }
+  return board.getHash() == board.computeHash();
+}
+} // namespace
+
+TEST_CASE("Incremental hash matches recomputed hash") {
+  Board board{
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"};
+  CHECK(hashIsConsistent(board, 3));
+
+  Board promotions{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"};
+  CHECK(hashIsConsistent(promotions, 3));
+}
+
+TEST_CASE("Finds mate in one") {
+  Board board{"6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"};
+  const TreeSearch::SearchResult result = searchToDepth(board, 3);
+
+  CHECK(result.best_move.formatted() == "a1a8");
+  CHECK(result.score == TreeSearch::MATE_SCORE - 1);
+}
+
+TEST_CASE("Finds scholar's mate with helper threads") {
+  Board board{"r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq "
+              "- 4 4"};
+  const TreeSearch::SearchResult result = searchToDepth(board, 3, 2);
+
+  CHECK(result.best_move.formatted() == "h5f7");
+}
+
+TEST_CASE("Quiescence searches evasions when in check") {
+  // Nxf7+ forks king and queen, standing pat after the check misses it
+  Board board{"3q3k/5p2/8/4N3/2B5/8/8/6K1 w - - 0 1"};
+  const TreeSearch::SearchResult result = searchToDepth(board, 1);
+
+  CHECK(result.best_move.formatted() == "e5f7");
+  CHECK(result.score > 300);
+}
+
+TEST_CASE("No legal moves") {
+  Board board{"7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"};
+  const TreeSearch::SearchResult result = searchToDepth(board, 3);
+
+  CHECK(result.best_move.pos_from == 0);
+}
+
+TEST_CASE("Fifty-move rule draws the search") {
+  // every move but a mate reaches the hundredth half-move
+  Board board{"k7/8/8/8/8/8/8/1R5K w - - 99 80"};
+  const TreeSearch::SearchResult result = searchToDepth(board, 3);
+
+  CHECK(result.score == 0);
+}
+
+TEST_CASE("Pondering holds the result until ponderhit") {
+  Board board{"6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"};
+  TranspositionTable tt;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> ponder{true};
+  TreeSearch::SearchLimits limits;
+  limits.depth = 3;
+
+  std::future<TreeSearch::SearchResult> result =
+      std::async(std::launch::async, [&] {
+        return TreeSearch::findBestMove(board, limits, tt, stop, 1, nullptr,
+                                        &ponder);
+      });
+
+  // the depth limit is reached long before, but the move is held back
+  CHECK(result.wait_for(std::chrono::milliseconds(100)) ==
+        std::future_status::timeout);
+  ponder.store(false);
+
+  const TreeSearch::SearchResult ponder_result = result.get();
+  CHECK(ponder_result.best_move.formatted() == "a1a8");
+  CHECK(ponder_result.depth == 3);
+}
+
+TEST_CASE("Transposition table clamps extended depths") {
+  TranspositionTable tt{1};
+  tt.store(0x1234, TreeSearch::MAX_PLY, 42, Bound::EXACT, nullptr);
+
+  TTEntry entry;
+  REQUIRE(tt.probe(0x1234, entry));
+  CHECK(entry.depth == TranspositionTable::MAX_DEPTH);
+  CHECK(entry.score == 42);
+}
+
+TEST_CASE("Time manager budgets") {
+  TreeSearch::SearchLimits limits;
+  limits.time_left[0] = 60'000;
+  limits.increment[0] = 1'000;
+
+  const TimeManager white{limits, 0};
+  CHECK(white.hasTimeLimit());
+  CHECK(white.softLimitMs() < white.hardLimitMs());
+  CHECK(white.hardLimitMs() <= 45'000);
+
+  // black has no clock information
+  const TimeManager black{limits, 1};
+  CHECK_FALSE(black.hasTimeLimit());
+
+  limits.infinite = true;
+  CHECK_FALSE(TimeManager(limits, 0).hasTimeLimit());
+}
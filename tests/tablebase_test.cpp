@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "board.hpp"
+#include "tablebase.hpp"
+#include "transposition-table.hpp"
+#include "tree-search.hpp"
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+// only built when the KQvK tables were found in SYZYGY_TEST_DIR
+#ifdef SYZYGY_TEST_DIR
+namespace {
+TreeSearch::SearchResult searchWithTables(const Board &board,
+                                          int32_t depth) {
+  TranspositionTable tt;
+  tt.resize(1);
+  std::atomic<bool> stop{false};
+  TreeSearch::SearchLimits limits;
+  limits.depth = depth;
+  limits.syzygy_probe_limit = 3;
+  return TreeSearch::findBestMove(board, limits, tt, stop);
+}
+} // namespace
+
+TEST_CASE("Syzygy probing of KQvK", "[syzygy]") {
+  REQUIRE(Tablebase::init(SYZYGY_TEST_DIR));
+  REQUIRE(Tablebase::largest() == 3);
+
+  const Board white_to_move{"4k3/8/8/8/8/8/8/4K2Q w - - 0 1"};
+  const Board black_to_move{"4k3/8/8/8/8/8/8/4K2Q b - - 0 1"};
+
+  SECTION("Win/draw/loss from the side to move") {
+    Tablebase::Wdl wdl;
+    REQUIRE(Tablebase::probeWdl(white_to_move, wdl));
+    CHECK(wdl == Tablebase::Wdl::WIN);
+    REQUIRE(Tablebase::probeWdl(black_to_move, wdl));
+    CHECK(wdl == Tablebase::Wdl::LOSS);
+  }
+
+  SECTION("The root move keeps the win") {
+    Move move;
+    Tablebase::Wdl wdl;
+    REQUIRE(Tablebase::probeRoot(white_to_move, move, wdl));
+    CHECK(wdl == Tablebase::Wdl::WIN);
+
+    Board after = white_to_move;
+    REQUIRE(after.makeMove(move.formatted()));
+    Tablebase::Wdl reply_wdl;
+    REQUIRE(Tablebase::probeWdl(after, reply_wdl));
+    CHECK(reply_wdl == Tablebase::Wdl::LOSS);
+  }
+
+  SECTION("The search plays the root probe's move") {
+    const TreeSearch::SearchResult result = searchWithTables(white_to_move, 5);
+    CHECK(result.score == TreeSearch::TB_WIN_SCORE);
+    CHECK(result.best_move.pos_from != 0);
+  }
+
+  SECTION("The search probes positions inside the tree") {
+    // taking the knight is the only way into the table
+    const Board board{"4k3/8/8/8/8/8/3n4/4K2Q w - - 0 1"};
+    const TreeSearch::SearchResult result = searchWithTables(board, 2);
+    CHECK(result.best_move.formatted() == "e1d2");
+    CHECK(result.score == TreeSearch::TB_WIN_SCORE - 1);
+  }
+
+  SECTION("Root probes from several threads") {
+    std::vector<std::future<TreeSearch::SearchResult>> results;
+    for (int32_t i = 0; i < 4; i++) {
+      results.push_back(std::async(std::launch::async, [&white_to_move] {
+        return searchWithTables(white_to_move, 5);
+      }));
+    }
+    for (std::future<TreeSearch::SearchResult> &result : results) {
+      CHECK(result.get().score == TreeSearch::TB_WIN_SCORE);
+    }
+  }
+
+  Tablebase::init("");
+}
+#endif